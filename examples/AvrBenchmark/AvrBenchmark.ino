@@ -0,0 +1,198 @@
+// cycles and SRAM of XBusServoEx on ATmega2560 for 1, 16 and 50 servos.
+// XBus is on Serial1 and the result is written to Serial, one line for
+// each item :
+//   bench <item> <servos> <value>
+// the cycles are counted by Timer1 without prescaler, less the cost of
+// the measurement itself.  conv* are the cycles of one unit conversion,
+// the float math of UnitConversionBenchmark and the integer one of
+// XBusServoEx side by side (servos is 0).  sendChannelDataPacket includes the wait for
+// the TX buffer of Serial1 when the packet is longer than it (64 bytes).
+// extras/avr_benchmark/run_benchmark.sh runs this under simavr and
+// compares the result with the baseline.  at the end the CPU sleeps with
+// the interrupts off, which stops simavr.
+
+#include <avr/sleep.h>
+#include <XBusServoEx.h>
+
+#define  kDirPinNum      2        // pin number for direction
+#define  kConvCount      100      // conversions for the average
+
+volatile uint16_t   gOverflow;
+uint32_t            gOverhead;
+volatile long       gInput;
+volatile unsigned int gOutput;
+
+extern char         __heap_start;
+extern char*        __brkval;
+
+
+ISR(TIMER1_OVF_vect)
+{
+  gOverflow++;
+}
+
+
+uint32_t cycles()
+{
+  uint8_t   sreg = SREG;
+  uint16_t  low;
+  uint16_t  high;
+
+  cli();
+  low = TCNT1;
+  high = gOverflow;
+  if ((TIFR1 & _BV(TOV1)) && (low < 0x8000))
+    high++;                               // overflow not served yet
+  SREG = sreg;
+
+  return ((uint32_t)high << 16) | low;
+}
+
+
+int freeMemory()
+{
+  char  top;
+
+  return &top - ((__brkval == 0) ? &__heap_start : __brkval);
+}
+
+
+void report(const char* item, int servoNum, uint32_t value)
+{
+  Serial.print("bench ");
+  Serial.print(item);
+  Serial.print(' ');
+  Serial.print(servoNum);
+  Serial.print(' ');
+  Serial.println(value);
+}
+
+
+// the same float math as UnitConversionBenchmark
+unsigned int floatUSecToRaw(long uSec)
+{
+  return (unsigned int)(kXbusServoNeutral + (uSec - 1500) * ((float)(kXbusServo2100uSec - kXbusServo900uSec) / 1200.0));
+}
+
+unsigned int floatDegToRaw(float deg)
+{
+  return (unsigned int)(kXbusServoNeutral + deg * ((float)(kXbusServo2100uSec - kXbusServo900uSec) / 180.0));
+}
+
+
+void conversion()
+{
+  uint32_t      start;
+  int           i;
+
+  start = cycles();
+  for (i = 0; i < kConvCount; i++)
+  {
+    gInput = 900 + i * 12;
+    gOutput = floatUSecToRaw(gInput);
+  }
+  report("convUSecFloat", 0, (cycles() - start - gOverhead) / kConvCount);
+
+  start = cycles();
+  for (i = 0; i < kConvCount; i++)
+  {
+    gInput = 900 + i * 12;
+    gOutput = XBusUSecToRaw(gInput);
+  }
+  report("convUSecInt", 0, (cycles() - start - gOverhead) / kConvCount);
+
+  start = cycles();
+  for (i = 0; i < kConvCount; i++)
+  {
+    gInput = i * 18 - 900;
+    gOutput = floatDegToRaw(gInput / 10.0);
+  }
+  report("convDegFloat", 0, (cycles() - start - gOverhead) / kConvCount);
+
+  start = cycles();
+  for (i = 0; i < kConvCount; i++)
+  {
+    gInput = i * 18 - 900;
+    gOutput = XBusDeciDegToRaw(gInput, true);
+  }
+  report("convDegInt", 0, (cycles() - start - gOverhead) / kConvCount);
+}
+
+
+void benchmark(int servoNum)
+{
+  XBusServoEx*  servo;
+  uint8_t       packet[kXBusMaxPacketSize];
+  uint32_t      start;
+  uint32_t      addTime;
+  uint32_t      time;
+  int           before;
+  int           id;
+
+  before = freeMemory();
+  servo = new XBusServoEx(kDirPinNum, servoNum);
+  servo->begin1();
+
+  // the last addServo is the slowest.  it searches all servos added
+  for (id = 1; id < servoNum; id++)
+    servo->addServo(id, kXbusServoNeutral);
+  start = cycles();
+  servo->addServo(servoNum, kXbusServoNeutral);
+  addTime = cycles() - start - gOverhead;
+  report("sram", servoNum, before - freeMemory());
+  report("addServo", servoNum, addTime);
+
+  start = cycles();
+  servo->setServo(servoNum, 0x1234);
+  report("setServo", servoNum, cycles() - start - gOverhead);
+
+  // the second packet after the first one is sent
+  servo->sendChannelDataPacket1();
+  Serial1.flush();
+  delay(2);
+  start = cycles();
+  servo->sendChannelDataPacket1();
+  time = cycles() - start - gOverhead;
+  Serial1.flush();
+  report("sendChannelDataPacket", servoNum, time);
+
+  memset(packet, servoNum, sizeof(packet));
+  start = cycles();
+  packet[0] = XBusServoEx::crc8(packet, 4 + servoNum * 4);
+  report("crc8", servoNum, cycles() - start - gOverhead);
+
+  servo->end1();
+  delete servo;
+}
+
+
+void setup()
+{
+  uint32_t  start;
+
+  Serial.begin(115200);
+
+  TCCR1A = 0;
+  TCCR1B = _BV(CS10);                     // count the CPU clock
+  TIMSK1 = _BV(TOIE1);
+
+  start = cycles();
+  gOverhead = cycles() - start;
+
+  benchmark(1);
+  benchmark(16);
+  benchmark(kXBusMaxServoNum);
+  conversion();
+  Serial.println("bench end");
+  Serial.flush();
+
+  cli();
+  set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+  sleep_enable();
+  sleep_cpu();
+}
+
+
+void loop()
+{
+}
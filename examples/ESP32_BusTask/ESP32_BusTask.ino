@@ -0,0 +1,51 @@
+// * cavle connection *
+//   XBusServo     -  ESP32
+//   outside black -  GND
+//   center black  -  5V or (POWER)
+//   outside white -  pin 17
+
+#include <XBusServoEx.h>
+#include <XBusTask.h>
+
+#define  kMaxServoNum    2       // numbers of XBus Servos 1 to 50
+#define  kDirPinNum      -1      // tx only mode
+#define  kBusCore        0       // loop() runs on core 1
+#define  kBusPriority    (configMAX_PRIORITIES - 2)
+
+XBusServoEx    myXBusServo(kDirPinNum, kMaxServoNum);
+XBusTask       myBusTask(myXBusServo, 2);       // Serial2
+float radiansval = 0.0;
+float radiansIncrement = 0.03;
+
+void setup()
+{
+  Serial.begin(115200);
+
+  myXBusServo.begin2();
+  myXBusServo.addServo(0x01, kXbusServoNeutral);    // servoID
+  myXBusServo.addServo(0x02, kXbusServoNeutral);
+
+  // the frames are sent by the bus task every kXBusInterval from here
+  myBusTask.begin(kBusCore, kBusPriority);
+}
+
+
+void loop()
+{
+  unsigned int   servoValue;
+
+  // make a sign curve
+  radiansval += radiansIncrement;
+  radiansval = (radiansval > 2 * PI) ? 0 : radiansval;
+  servoValue = 32767 + int(sin(radiansval) * 30426);
+
+  // both servos move in the same frame
+  myBusTask.beginPose();
+  myBusTask.setServo(0, servoValue);
+  myBusTask.setServo(1, 65535 - servoValue);
+  myBusTask.endPose();
+
+  // heavy work here does not delay the frames
+  Serial.println(myBusTask.getMaxJitter());
+  delay(10);
+}
@@ -0,0 +1,53 @@
+#include <MsTimer2.h>
+#include <XBusServoEx.h>
+#include <XBusGroupSet.h>
+
+// XBus is on Serial1, and the result is written to Serial.
+// The speed limit of all servos is set with the commands back to back.
+
+#define  kMaxServoNum    30       // 1 - 50
+#define  kDirPinNum      2        // pin number for direction
+
+XBusServoEx     myXBusServo(kDirPinNum, kMaxServoNum);
+XBusGroupSet    myGroupSet(myXBusServo);
+
+
+void setup()
+{
+  Serial.begin(115200);
+  myXBusServo.begin1();
+  for (int id = 1; id <= kMaxServoNum; id++)
+    myXBusServo.addServo(id, kXbusServoNeutral);
+
+  MsTimer2::set(kXBusInterval, sendPacket);
+  MsTimer2::start();
+
+  // 5mSec timeout for each servo, and set again the servos failed once
+  XBusError result = myGroupSet.run(kXBusOrder_1_SpeedLimit, 10, 5000, 2);
+
+  Serial.print("result ");
+  Serial.print(result);
+  Serial.print(" acks ");
+  Serial.print(myGroupSet.ackCount());
+  Serial.print(" uSec ");
+  Serial.println(myGroupSet.getElapsedTime());
+
+  for (int servoNo = 0; servoNo < myXBusServo.getNumOfServo(); servoNo++)
+    if (! myGroupSet.isAcked(servoNo))
+    {
+      Serial.print("no ack from ID ");
+      Serial.println(myXBusServo.getServoID(servoNo), HEX);
+    }
+}
+
+
+// This is the handler to keep to send channel command packet with 14mSec interval.
+void sendPacket()
+{
+  myXBusServo.sendChannelDataPacket1();
+}
+
+
+void loop()
+{
+}
@@ -0,0 +1,47 @@
+#include <MsTimer2.h>
+#include <XBusServoEx.h>
+#include <XBusHealth.h>
+
+// XBus is on Serial1, and the health report is written to Serial.
+
+#define  kMaxServoNum    2        // 1 - 50
+#define  kDirPinNum      2        // pin number for direction
+
+XBusServoEx         myXBusServo(kDirPinNum, kMaxServoNum);
+XBusHealthMonitor   myHealth(myXBusServo, kMaxServoNum);
+unsigned long       reportTime;
+
+
+void setup()
+{
+  Serial.begin(115200);
+  myXBusServo.begin1();
+  myXBusServo.addServo(0x01, kXbusServoNeutral);
+  myXBusServo.addServo(0x02, kXbusServoNeutral);
+
+  myHealth.begin(100);                  // one command in 100mSec
+  reportTime = millis();
+
+  MsTimer2::set(kXBusInterval, sendPacket);
+  MsTimer2::start();
+}
+
+
+// This is the handler to keep to send channel command packet with 14mSec interval.
+void sendPacket()
+{
+  myXBusServo.sendChannelDataPacket1();
+}
+
+
+void loop()
+{
+  myHealth.update();
+
+  // ID commands CRCErrors timeouts echoErrors retries power alarmLevel latency...
+  if ((millis() - reportTime) >= 5000)
+  {
+    myHealth.printHealth(Serial);
+    reportTime = millis();
+  }
+}
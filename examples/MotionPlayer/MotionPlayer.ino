@@ -0,0 +1,46 @@
+#include <MsTimer2.h>
+#include <XBusServoEx.h>
+#include <XBusMotion.h>
+
+#define  kMaxServoNum    2        // 1 - 50
+#define  kDirPinNum      2        // pin number for direction
+
+XBusServoEx       myXBusServo(kDirPinNum, kMaxServoNum);
+XBusMotionPlayer  myMotion(myXBusServo);
+
+// 2 channels, 3 keyframes.  the motion stays in flash
+static const uint8_t swingMotion[] PROGMEM = {
+  XBUS_MOTION_HEADER(2, 3),
+  // frames                   channel 1                              channel 2
+  XBUS_MOTION_U16(0),         XBUS_MOTION_U16(kXbusServoNeutral),    XBUS_MOTION_U16(kXbusServoNeutral),
+  XBUS_MOTION_U16(50),        XBUS_MOTION_DELTA(kXbusServoNeutral, kXbusServo2100uSec),
+                              XBUS_MOTION_DELTA(kXbusServoNeutral, kXbusServo900uSec),
+  XBUS_MOTION_U16(50),        XBUS_MOTION_DELTA(kXbusServo2100uSec, kXbusServoNeutral),
+                              XBUS_MOTION_DELTA(kXbusServo900uSec, kXbusServoNeutral),
+};
+
+
+void setup()
+{
+  myXBusServo.begin();
+  myXBusServo.addServo(0x01, kXbusServoNeutral);
+  myXBusServo.addServo(0x02, kXbusServoNeutral);
+
+  myMotion.play(swingMotion, true);
+
+  MsTimer2::set(kXBusInterval, sendPacket);
+  MsTimer2::start();
+}
+
+
+// This is the handler to keep to send channel command packet with 14mSec interval.
+void sendPacket()
+{
+  myMotion.update();
+  myXBusServo.sendChannelDataPacket();
+}
+
+
+void loop()
+{
+}
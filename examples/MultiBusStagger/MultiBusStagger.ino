@@ -0,0 +1,77 @@
+#include <MsTimer2.h>
+#include <XBusServoEx.h>
+#include <XBusScheduler.h>
+
+// Three buses on Serial1, Serial2 and Serial3 of Arduino Mega.
+// The frames are spread in kXBusInterval, so the buses do not start
+// to build and send their frames in the same timer tick, and the servos
+// of each bus start to move at different times.
+
+#define  kMaxServoNum    2        // 1 - 50 for each bus
+
+XBusServoEx     myXBusServo1(2, kMaxServoNum);
+XBusServoEx     myXBusServo2(3, kMaxServoNum);
+XBusServoEx     myXBusServo3(4, kMaxServoNum);
+XBusScheduler   myScheduler;
+unsigned long   reportTime;
+
+
+void setup()
+{
+  Serial.begin(115200);
+
+  myXBusServo1.begin1();
+  myXBusServo2.begin2();
+  myXBusServo3.begin3();
+  myXBusServo1.addServo(0x01, kXbusServoNeutral);
+  myXBusServo1.addServo(0x02, kXbusServoNeutral);
+  myXBusServo2.addServo(0x01, kXbusServoNeutral);
+  myXBusServo2.addServo(0x02, kXbusServoNeutral);
+  myXBusServo3.addServo(0x01, kXbusServoNeutral);
+  myXBusServo3.addServo(0x02, kXbusServoNeutral);
+
+  myScheduler.addBus(myXBusServo1, 1, 0);
+  myScheduler.addBus(myXBusServo2, 2, 0);
+  myScheduler.addBus(myXBusServo3, 3, 0);
+  myScheduler.spreadPhases();       // 0, 4.67 and 9.33 mSec
+  myScheduler.start();
+  reportTime = millis();
+
+  MsTimer2::set(1, tick);           // the phase resolution is 1mSec
+  MsTimer2::start();
+}
+
+
+// This is the handler to send the frame of the bus whose time has come.
+void tick()
+{
+  myScheduler.tick();
+}
+
+
+void loop()
+{
+  static unsigned int value = 0;
+
+  value += 0x0100;
+  myXBusServo1.setServo(0x01, value);
+  myXBusServo2.setServo(0x01, value);
+  myXBusServo3.setServo(0x01, value);
+  delay(10);
+
+  // peak uSec of one tick, max frames in one tick, peak uSec of each bus
+  if ((millis() - reportTime) >= 5000)
+  {
+    Serial.print(myScheduler.getPeakTickTime());
+    Serial.print(' ');
+    Serial.print(myScheduler.getPeakBusesPerTick());
+    for (int busNo = 0; busNo < 3; busNo++)
+    {
+      Serial.print(' ');
+      Serial.print(myScheduler.getPeakBusTime(busNo));
+    }
+    Serial.println();
+    myScheduler.clearPeak();
+    reportTime = millis();
+  }
+}
@@ -0,0 +1,98 @@
+#include <EEPROM.h>
+#include <XBusServoEx.h>
+#include <XBusParams.h>
+
+// XBus is on Serial1, and the result is written to Serial.
+// Send 's' to save the parameters of the servos to EEPROM, 'd' to show
+// the parameters different from EEPROM, and 'r' to restore them (e.g.
+// after a servo is swapped and its channel ID is set).
+
+#define  kMaxServoNum    4        // 1 - 50
+#define  kDirPinNum      2        // pin number for direction
+#define  kEEPROMAddress  0
+
+XBusServoEx         myXBusServo(kDirPinNum, kMaxServoNum);
+XBusParamSnapshot   mySnapshot(myXBusServo);
+uint8_t             blob[XBusParamBlobSize(kMaxServoNum)];
+
+
+void setup()
+{
+  Serial.begin(115200);
+  myXBusServo.begin1();
+  myXBusServo.addServo(0x01, kXbusServoNeutral);
+  myXBusServo.addServo(0x02, kXbusServoNeutral);
+  myXBusServo.addServo(0x03, kXbusServoNeutral);
+  myXBusServo.addServo(0x04, kXbusServoNeutral);
+}
+
+
+void loop()
+{
+  XBusError   result;
+  int         numOfFields;
+
+  switch (Serial.read())
+  {
+    case 's':
+      result = mySnapshot.snapshot(blob, sizeof(blob));
+      if (result == kXBusError_NoError)
+      {
+        // write only the bytes changed to save the EEPROM
+        for (unsigned int i = 0; i < sizeof(blob); i++)
+          if (EEPROM.read(kEEPROMAddress + i) != blob[i])
+            EEPROM.write(kEEPROMAddress + i, blob[i]);
+      }
+      Serial.print("save ");
+      Serial.println(result);
+      break;
+
+    case 'd':
+      if (loadBlob())
+        for (int servoNo = 0; servoNo < myXBusServo.getNumOfServo(); servoNo++)
+        {
+          unsigned long   diffMask = 0;
+
+          result = mySnapshot.diff(blob, myXBusServo.getServoID(servoNo), &diffMask);
+          Serial.print("ID ");
+          Serial.print(myXBusServo.getServoID(servoNo), HEX);
+          Serial.print(" result ");
+          Serial.print(result);
+          Serial.print(" orders");
+          for (int paramNo = 0; paramNo < kXBusParamNum; paramNo++)
+            if (diffMask & (1UL << paramNo))
+            {
+              Serial.print(' ');
+              Serial.print(XBusParamSnapshot::getParamOrder(paramNo), HEX);
+            }
+          Serial.println();
+        }
+      break;
+
+    case 'r':
+      if (loadBlob())
+      {
+        result = mySnapshot.restoreAll(blob, &numOfFields);
+        Serial.print("restore ");
+        Serial.print(result);
+        Serial.print(" fields ");
+        Serial.println(numOfFields);
+      }
+      break;
+  }
+}
+
+
+bool loadBlob()
+{
+  for (unsigned int i = 0; i < sizeof(blob); i++)
+    blob[i] = EEPROM.read(kEEPROMAddress + i);
+
+  if (mySnapshot.check(blob, sizeof(blob)) != kXBusError_NoError)
+  {
+    Serial.println("no snapshot in EEPROM");
+    return false;
+  }
+
+  return true;
+}
@@ -0,0 +1,45 @@
+#include <MsTimer2.h>
+#include <XBusServoEx.h>
+#include <XBusBridge.h>
+
+// The poses from the PC come to Serial (USB) in the frame format of
+// XBusBridge.h, and XBus is on Serial1.
+// XBusBridge::encode() makes the frame on the PC.
+
+#define  kMaxServoNum    8        // 1 - 50
+#define  kDirPinNum      2        // pin number for direction
+
+XBusServoEx         myXBusServo(kDirPinNum, kMaxServoNum);
+XBusBridge          myBridge(myXBusServo);
+
+
+void setup()
+{
+  int   id;
+
+  Serial.begin(1000000);
+  myXBusServo.begin1();
+
+  // the index in the frame is the order of addServo
+  for (id = 1; id <= kMaxServoNum; id++)
+    myXBusServo.addServo(id, kXbusServoNeutral);
+
+  myBridge.begin(Serial);
+
+  MsTimer2::set(kXBusInterval, sendPacket);
+  MsTimer2::start();
+}
+
+
+// This is the handler to keep to send channel command packet with 14mSec interval.
+void sendPacket()
+{
+  myXBusServo.sendChannelDataPacket1();
+}
+
+
+void loop()
+{
+  // the pose goes out with the next channel data packet
+  myBridge.poll();
+}
@@ -0,0 +1,23 @@
+#include <XBusSniffer.h>
+
+// Connect RX of Serial1 to the XBus signal line (do not connect TX).
+// The captured packets are written to Serial in the capture record format,
+// decode them on the PC with extras/xbus_sniff_decode.cpp.
+
+static uint8_t    captureRing[1024];          // power of 2
+XBusSniffer       mySniffer(captureRing, sizeof(captureRing));
+
+
+void setup()
+{
+  Serial.begin(1000000);
+  Serial1.begin(kXBusBaudrate);
+  mySniffer.begin(Serial1);
+}
+
+
+void loop()
+{
+  mySniffer.poll();
+  mySniffer.dump(Serial);
+}
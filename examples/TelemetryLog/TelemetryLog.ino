@@ -0,0 +1,64 @@
+#include <SPI.h>
+#include <SD.h>
+#include <MsTimer2.h>
+#include <XBusServoEx.h>
+#include <XBusTelemetry.h>
+
+// XBus is on Serial1, and the telemetry log is written to the SD card.
+// extras/xbus_telemetry_decode.cpp decodes XBUSLOG.BIN on the PC.
+
+#define  kMaxServoNum    4        // 1 - 50
+#define  kDirPinNum      2        // pin number for direction
+#define  kSDChipSelect   53
+#define  kBlockSize      512      // a sector of SD card
+
+XBusServoEx         myXBusServo(kDirPinNum, kMaxServoNum);
+uint8_t             logBuffer[kBlockSize * 2];
+XBusTelemetry       myLog(myXBusServo, kMaxServoNum, logBuffer, kBlockSize);
+File                logFile;
+volatile boolean    frameSent = false;
+
+
+void setup()
+{
+  Serial.begin(115200);
+  myXBusServo.begin1();
+  myXBusServo.addServo(0x01, kXbusServoNeutral);
+  myXBusServo.addServo(0x02, kXbusServoNeutral);
+
+  if (! SD.begin(kSDChipSelect))
+    Serial.println("no SD card");
+  logFile = SD.open("XBUSLOG.BIN", FILE_WRITE);
+  myLog.begin(logFile);
+
+  MsTimer2::set(kXBusInterval, sendPacket);
+  MsTimer2::start();
+}
+
+
+// This is the handler to keep to send channel command packet with 14mSec interval.
+void sendPacket()
+{
+  myXBusServo.sendChannelDataPacket1();
+  frameSent = true;
+}
+
+
+void loop()
+{
+  // one sample for each frame.  the full block is written to SD little by little
+  if (frameSent)
+  {
+    frameSent = false;
+    myLog.sample();
+  }
+  myLog.update();
+
+  // close the log with a character from Serial
+  if (Serial.read() >= 0)
+  {
+    myLog.end();
+    logFile.close();
+    Serial.println("log closed");
+  }
+}
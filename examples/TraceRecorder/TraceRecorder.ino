@@ -0,0 +1,52 @@
+#include <MsTimer2.h>
+#include <XBusServoEx.h>
+#include <XBusRecordRing.h>
+
+// XBus is on Serial1, and the trace is written to Serial.
+// Save it to a file on the PC and replay it with extras/host/xbus_trace_replay.cpp.
+
+#define  kMaxServoNum    2        // 1 - 50
+#define  kDirPinNum      2        // pin number for direction
+
+static uint8_t    traceRing[2048];        // power of 2
+XBusRecordRing    myTrace(traceRing, sizeof(traceRing));
+XBusServoEx       myXBusServo(kDirPinNum, kMaxServoNum);
+unsigned int      servoValue;
+
+
+void setup()
+{
+  servoValue = kXbusServoNeutral;
+
+  Serial.begin(1000000);
+  myXBusServo.begin1();
+  myXBusServo.setTraceRecorder(&myTrace);
+  myXBusServo.addServo(0x01, kXbusServoNeutral);
+  myXBusServo.addServo(0x02, kXbusServoNeutral);
+
+  MsTimer2::set(kXBusInterval, sendPacket);
+  MsTimer2::start();
+}
+
+
+// This is the handler to keep to send channel command packet with 14mSec interval.
+void sendPacket()
+{
+  myXBusServo.sendChannelDataPacket1();
+}
+
+
+void loop()
+{
+  int   value;
+
+  servoValue += 10;
+  myXBusServo.setServo(1, servoValue);
+  myXBusServo.setServo(2, servoValue);
+
+  if ((servoValue & 0x0FFF) == 0)
+    myXBusServo.getCommand(0x01, kXBusOrder_2_CurrentPos, &value);
+
+  myTrace.dump(Serial);
+  delay(5);
+}
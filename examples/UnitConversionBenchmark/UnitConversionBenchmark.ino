@@ -0,0 +1,89 @@
+// compare the integer unit conversion of XBusServoEx with the float math
+// that sketches used to do.  the result is printed on Serial in uSec
+// (4 uSec resolution of micros() on AVR).
+// AvrBenchmark runs the same float functions under simavr, and the cycles
+// of one conversion on ATmega2560 are kept in extras/avr_benchmark/baseline.txt
+// as convUSecFloat / convUSecInt and convDegFloat / convDegInt.
+
+#include <XBusServoEx.h>
+
+#define  kLoopCount      1000
+
+volatile long           gInput;
+volatile unsigned int   gOutput;
+
+
+unsigned int floatUSecToRaw(long uSec)
+{
+  return (unsigned int)(kXbusServoNeutral + (uSec - 1500) * ((float)(kXbusServo2100uSec - kXbusServo900uSec) / 1200.0));
+}
+
+unsigned int floatDegToRaw(float deg)
+{
+  return (unsigned int)(kXbusServoNeutral + deg * ((float)(kXbusServo2100uSec - kXbusServo900uSec) / 180.0));
+}
+
+
+void setup()
+{
+  unsigned long   start;
+  unsigned long   floatTime;
+  unsigned long   intTime;
+  int             i;
+
+  Serial.begin(115200);
+
+  // uSec -> raw
+  start = micros();
+  for (i = 0; i < kLoopCount; i++)
+  {
+    gInput = 900 + (i % 1200);
+    gOutput = floatUSecToRaw(gInput);
+  }
+  floatTime = micros() - start;
+
+  start = micros();
+  for (i = 0; i < kLoopCount; i++)
+  {
+    gInput = 900 + (i % 1200);
+    gOutput = XBusUSecToRaw(gInput);
+  }
+  intTime = micros() - start;
+
+  Serial.print("uSec->raw  float: ");
+  Serial.print(floatTime);
+  Serial.print(" uSec  integer: ");
+  Serial.print(intTime);
+  Serial.println(" uSec");
+
+  // degree -> raw (180 degree mode)
+  start = micros();
+  for (i = 0; i < kLoopCount; i++)
+  {
+    gInput = (i % 1800) - 900;
+    gOutput = floatDegToRaw(gInput / 10.0);
+  }
+  floatTime = micros() - start;
+
+  start = micros();
+  for (i = 0; i < kLoopCount; i++)
+  {
+    gInput = (i % 1800) - 900;
+    gOutput = XBusDeciDegToRaw(gInput, true);
+  }
+  intTime = micros() - start;
+
+  Serial.print("deg->raw   float: ");
+  Serial.print(floatTime);
+  Serial.print(" uSec  integer: ");
+  Serial.print(intTime);
+  Serial.println(" uSec");
+  Serial.print("(for ");
+  Serial.print(kLoopCount);
+  Serial.println(" conversions)");
+}
+
+
+void loop()
+{
+}
@@ -57,34 +57,41 @@ rotalyType;
 
 //
 // servo command data base
+//	write index, size, sign and range come from the order descriptor table of XBusServoEx.
+//	the order only for get is not editable (max == min)
 //
+#define kCommandRec(name, order, hex)	{name, order, XBusOrderDesc<order>::paramIndex, \
+					 (unsigned char)(XBusOrderDesc<order>::size + 3), hex, ! XBusOrderDesc<order>::isSigned, \
+					 XBusOrderDesc<order>::canSet ? XBusOrderDesc<order>::maxValue : 0, \
+					 XBusOrderDesc<order>::canSet ? XBusOrderDesc<order>::minValue : 0}
+
 static const servoCommandRec		commandData[] = {
   //  name		order			write index				size    hex    unsin    max	min
 	{"Pos ",	0x00,				0,				0,	1,	1,	0x0FFFF,  0x0000},
 	{"ID  ",	0x00,				0,				0,	0,	0,	50,	  1},
 	{"SbID",	0x00,				0,				0,	0,	0,	3,	  0},
-	{"Ver.",	kXBusOrder_2_Version,		0,				5,	1,	1,	0,	  0},
-	{"Modl",	kXBusOrder_2_Product,		0,				5,	1,	1,	0,	  0},
-	{"Rev ",	kXBusOrder_2_Reverse,		kParamIdx_Reversed,		5,	0,	0,	1,	  0},
-	{"Ntrl",	kXBusOrder_2_Neutral,		kParamIdx_NeutralOffset,	5,	0,	0,	300,      -300},
-	{"HTrv",	kXBusOrder_2_H_Travel,		kParamIdx_TravelHigh,		5,	0,	0,	192,	  0},
-	{"LTrv",	kXBusOrder_2_L_Travel,		kParamIdx_TravelLow,		5,	0,	0,	192,	  0},
-	{"HLim",	kXBusOrder_2_H_Limit,		kParamIdx_LimitHigh,		5,	1,	1,	0x0FFFF,  0x0000},
-	{"LLim",	kXBusOrder_2_L_Limit,		kParamIdx_LimitLow,		5,	1,	1,	0x0FFFF,  0x0000},
-	{"P-Gn",	kXBusOrder_1_P_Gain,		kParamIdx_PGainDiff,		4,	0,	0,	50,	  -50},
-	{"I-Gn",	kXBusOrder_1_I_Gain,		kParamIdx_IGainDiff,		4,	0,	0,	50,	  -50},
-	{"D-Gn",	kXBusOrder_1_D_Gain,		kParamIdx_DGainDiff,		4,	0,	0,	50,	  -50},
-	{"IMax",	kXBusOrder_2_MaxInteger,	kParamIdx_MaxIntegerDiff,	5,	0,	0,	999,	  -999},
-	{"DedB",	kXBusOrder_1_DeadBand,		kParamIdx_DeadBandDiff,		4,	0,	0,	10, 	  -10},
-	{"180M",	kXBusOrder_1_Angle_180,		kParamIdx_Angle_180,		4,	0,	0,	1,	  0},
-	{"SpdL",	kXBusOrder_1_SpeedLimit,	kParamIdx_SpeedLimit,		4,	0,	0,	30,	  0},
-	{"StpM",	kXBusOrder_1_StopMode,		kParamIdx_StopMode,		4,	0,	0,	1,	  0},
-	{"POff",	kXBusOrder_2_PowerOffset,	kParamIdx_PWOffsetDiff,		5,	0,	0,	999,	  -999},
-	{"SlwS",	kXBusOrder_1_SlowStart,		kParamIdx_SlowStart,		4,	0,	0,	1,	  0},
-	{"AlLv",	kXBusOrder_1_AlarmLevel,	kParamIdx_AlarmLevel,		4,	0,	0,	99,	  0},
-	{"AlDy",	kXBusOrder_2_AlarmDelay,	kParamIdx_AlarmDelay,		5,	0,	0,	5000,	  0},
-	{"CPos",	kXBusOrder_2_CurrentPos,	0,				5,	1,	0,	0,	  0},
-	{"CPow",	kXBusOrder_1_CurrentPow,	0,				4,	0,	0,	0,	  0}
+	kCommandRec("Ver.",	kXBusOrder_2_Version,		1),
+	kCommandRec("Modl",	kXBusOrder_2_Product,		1),
+	kCommandRec("Rev ",	kXBusOrder_2_Reverse,		0),
+	kCommandRec("Ntrl",	kXBusOrder_2_Neutral,		0),
+	kCommandRec("HTrv",	kXBusOrder_2_H_Travel,		0),
+	kCommandRec("LTrv",	kXBusOrder_2_L_Travel,		0),
+	kCommandRec("HLim",	kXBusOrder_2_H_Limit,		1),
+	kCommandRec("LLim",	kXBusOrder_2_L_Limit,		1),
+	kCommandRec("P-Gn",	kXBusOrder_1_P_Gain,		0),
+	kCommandRec("I-Gn",	kXBusOrder_1_I_Gain,		0),
+	kCommandRec("D-Gn",	kXBusOrder_1_D_Gain,		0),
+	kCommandRec("IMax",	kXBusOrder_2_MaxInteger,	0),
+	kCommandRec("DedB",	kXBusOrder_1_DeadBand,		0),
+	kCommandRec("180M",	kXBusOrder_1_Angle_180,		0),
+	kCommandRec("SpdL",	kXBusOrder_1_SpeedLimit,	0),
+	kCommandRec("StpM",	kXBusOrder_1_StopMode,		0),
+	kCommandRec("POff",	kXBusOrder_2_PowerOffset,	0),
+	kCommandRec("SlwS",	kXBusOrder_1_SlowStart,		0),
+	kCommandRec("AlLv",	kXBusOrder_1_AlarmLevel,	0),
+	kCommandRec("AlDy",	kXBusOrder_2_AlarmDelay,	0),
+	kCommandRec("CPos",	kXBusOrder_2_CurrentPos,	1),
+	kCommandRec("CPow",	kXBusOrder_1_CurrentPow,	0)
 	};
 
 
@@ -549,7 +556,7 @@ void getCurrentValue()
 		}
 		gCurrentValue = theValue;
 		if (commandData[gCurrentFunction].unsignedData)
-			gCurrentValue &= 0x0000FFFF;
+			gCurrentValue &= (commandData[gCurrentFunction].payloadSize == 5) ? 0x0000FFFF : 0x000000FF;
 		break;
 	}
 }
@@ -0,0 +1,96 @@
+#!/bin/sh
+# run_benchmark.sh
+#
+# for host PC
+#
+# build examples/AvrBenchmark for Arduino MEGA, run it under simavr and
+# compare the cycles and SRAM with the baseline.
+#
+#	needs :	arduino-cli with arduino:avr, simavr, avr-size
+#	usage :	run_benchmark.sh [-u] [-t percent]
+#			-u			write the result to the baseline
+#			-t percent	allowed increase from the baseline (default 0)
+#
+# the result and the baseline are the lines "<item> <servos> <value>".
+# the static RAM (.data + .bss) and the flash of the sketch are added as
+# "data 0" and "text 0".  simavr is cycle accurate, so the same build
+# gives the same numbers.
+#
+#	exit code :	0 ok (or the baseline is written with -u)
+#				1 an item is larger than the baseline by more than the percent
+#				2 the build or the benchmark failed
+#				3 the baseline has no item.  run with -u and commit it
+#
+# the baseline is written only with -u, and its lines with # are kept.  a
+# baseline without numbers is an error, so the check can not pass silently.
+
+set -e
+
+DIR=$(cd "$(dirname "$0")" && pwd)
+ROOT=$(cd "$DIR/../.." && pwd)
+BASELINE="$DIR/baseline.txt"
+BUILD="${BUILD_DIR:-/tmp/xbus_avr_benchmark}"
+FQBN="arduino:avr:mega"
+MCU="atmega2560"
+UPDATE=0
+TOLERANCE=0
+
+while [ $# -gt 0 ]; do
+	case "$1" in
+		-u)	UPDATE=1 ;;
+		-t)	TOLERANCE="$2"; shift ;;
+		*)	echo "usage : run_benchmark.sh [-u] [-t percent]" >&2; exit 2 ;;
+	esac
+	shift
+done
+
+mkdir -p "$BUILD"
+arduino-cli compile --fqbn "$FQBN" --library "$ROOT" --output-dir "$BUILD" "$ROOT/examples/AvrBenchmark" > "$BUILD/compile.log"
+ELF="$BUILD/AvrBenchmark.ino.elf"
+
+# simavr prints the output of UART0.  it stops when the sketch sleeps
+# with the interrupts off
+timeout 120 simavr -m "$MCU" -f 16000000 "$ELF" > "$BUILD/simavr.log" 2>&1 || true
+if ! grep -q "bench end" "$BUILD/simavr.log"; then
+	echo "the benchmark did not finish.  see $BUILD/simavr.log" >&2
+	exit 2
+fi
+
+grep -o "bench [A-Za-z0-9]* [0-9]* [0-9]*" "$BUILD/simavr.log" | sed 's/^bench //' > "$BUILD/result.txt"
+avr-size -A "$ELF" | awk '$1 == ".data" || $1 == ".bss" { data += $2 } $1 == ".text" { text = $2 }
+	END { print "data 0 " data; print "text 0 " text }' >> "$BUILD/result.txt"
+
+cat "$BUILD/result.txt"
+
+if [ "$UPDATE" = 1 ]; then
+	{ grep '^#' "$BASELINE" 2> /dev/null || true; cat "$BUILD/result.txt"; } > "$BUILD/baseline.txt"
+	cp "$BUILD/baseline.txt" "$BASELINE"
+	echo "baseline written to $BASELINE"
+	exit 0
+fi
+
+if ! grep -q '^[a-z]' "$BASELINE" 2> /dev/null; then
+	echo "no numbers in $BASELINE.  run with -u on the reference build and commit it" >&2
+	exit 3
+fi
+
+awk -v tolerance="$TOLERANCE" '
+	/^#/ { next }
+	FNR == NR { base[$1 " " $2] = $3; next }
+	{
+		key = $1 " " $2
+		if (! (key in base))
+		{
+			print "new      " key " " $3
+			next
+		}
+		limit = base[key] * (100 + tolerance) / 100
+		if ($3 > limit)
+		{
+			print "REGRESS  " key " " base[key] " -> " $3
+			failed = 1
+		}
+		else if ($3 < base[key])
+			print "better   " key " " base[key] " -> " $3
+	}
+	END { exit failed }' "$BASELINE" "$BUILD/result.txt"
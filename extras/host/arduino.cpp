@@ -0,0 +1,158 @@
+/* arduino.cpp file
+ *
+ * for host PC
+ *
+ * minimum Arduino API to compile XBusServoEx on the host PC
+ */
+
+#include "arduino.h"
+#include <time.h>
+#include <sched.h>
+
+HardwareSerial	Serial, Serial1, Serial2, Serial3, Serial4, Serial5;
+void			(*hostYieldHook)(void) = NULL;
+void			(*hostDigitalWriteHook)(int pin, int value) = NULL;
+
+static uint64_t	hostClock = 0;						// uSec
+static bool		realClock = false;
+
+
+static uint64_t realMicros(void)
+{
+	struct timespec		now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+
+//****************************************************************************
+//	virtual clock
+//		micros() keeps the low 32 bits of the clock like Arduino, and
+//		millis() is calculated from the whole clock.  yield() moves the clock
+//		1 uSec so that the loops waiting the time end.
+//		after hostUseRealClock(), they use CLOCK_MONOTONIC and really wait
+//****************************************************************************
+unsigned long micros(void)
+{
+	return (uint32_t)(realClock ? realMicros() : hostClock);
+}
+
+unsigned long millis(void)
+{
+	return (uint32_t)((realClock ? realMicros() : hostClock) / 1000);
+}
+
+void hostUseRealClock(void)
+{
+	realClock = true;
+}
+
+void hostSetMicros(unsigned long time)
+{
+	// never go back
+	if ((int32_t)((uint32_t)time - (uint32_t)hostClock) > 0)
+		hostClock += (uint32_t)time - (uint32_t)hostClock;
+}
+
+void hostAdvanceMicros(unsigned long time)
+{
+	hostClock += time;
+}
+
+void delay(unsigned long ms)
+{
+	if (realClock)
+	{
+		struct timespec		wait;
+
+		wait.tv_sec = ms / 1000;
+		wait.tv_nsec = (ms % 1000) * 1000000L;
+		nanosleep(&wait, NULL);
+	}
+	else
+		hostClock += (uint64_t)ms * 1000;
+
+	if (hostYieldHook != NULL)
+		hostYieldHook();
+}
+
+void delayMicroseconds(unsigned int us)
+{
+	if (realClock)
+	{
+		uint64_t	start = realMicros();
+
+		while (realMicros() - start < us)
+			;
+	}
+	else
+		hostClock += us;
+}
+
+void yield(void)
+{
+	if (realClock)
+		sched_yield();
+	else
+		hostClock++;
+
+	if (hostYieldHook != NULL)
+		hostYieldHook();
+}
+
+void digitalWrite(int pin, int value)
+{
+	if (hostDigitalWriteHook != NULL)
+		hostDigitalWriteHook(pin, value);
+}
+
+
+//****************************************************************************
+//	Print / Stream
+//****************************************************************************
+size_t Print::write(const uint8_t* buffer, size_t size)
+{
+	size_t		written = 0;
+
+	while (size-- > 0)
+		written += write(*buffer++);
+
+	return written;
+}
+
+size_t Print::print(long value, int base)
+{
+	char		text[24];
+
+	snprintf(text, sizeof(text), (base == HEX) ? "%lx" : "%ld", value);
+	return write(text);
+}
+
+size_t Print::print(unsigned long value, int base)
+{
+	char		text[24];
+
+	snprintf(text, sizeof(text), (base == HEX) ? "%lx" : "%lu", value);
+	return write(text);
+}
+
+size_t Stream::readBytes(char* buffer, size_t size)
+{
+	size_t			count = 0;
+	unsigned long	start = millis();
+	int				data;
+
+	while (count < size)
+	{
+		data = read();
+		if (data >= 0)
+			buffer[count++] = data;
+		else if ((millis() - start) >= timeout)
+			break;
+		else
+			yield();
+	}
+
+	return count;
+}
@@ -0,0 +1,121 @@
+/* arduino.h file
+ *
+ * for host PC
+ *
+ * minimum Arduino API to compile XBusServoEx on the host PC.
+ * micros() / millis() run on a virtual clock moved by the host program
+ * (or on the real clock after hostUseRealClock()), Serial to Serial5 forward
+ * to the Stream attached by the host program, and digitalWrite() calls
+ * hostDigitalWriteHook
+ */
+
+#ifndef arduino_h
+#define arduino_h
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <math.h>
+
+// the echo through the USB-UART adapter comes after its latency timer
+#if ! defined(XBUS_ECHO_MARGIN)
+#define	XBUS_ECHO_MARGIN			20000		// uSec
+#endif
+
+#define	PROGMEM
+#define	pgm_read_byte(p)			(*(const uint8_t*)(p))
+#define	pgm_read_word(p)			(*(const uint16_t*)(p))
+#define	pgm_read_dword(p)			(*(const uint32_t*)(p))
+#define	pgm_read_ptr(p)				(*(void* const*)(p))
+
+#define	INPUT						0
+#define	OUTPUT						1
+#define	LOW							0
+#define	HIGH						1
+#define	DEC							10
+#define	HEX							16
+
+typedef bool		boolean;
+typedef uint8_t		byte;
+
+unsigned long	micros(void);
+unsigned long	millis(void);
+void			delay(unsigned long ms);
+void			delayMicroseconds(unsigned int us);
+void			yield(void);
+inline void		pinMode(int, int) {}
+void			digitalWrite(int pin, int value);
+inline void		noInterrupts(void) {}
+inline void		interrupts(void) {}
+
+// virtual clock
+void			hostSetMicros(unsigned long time);
+void			hostAdvanceMicros(unsigned long time);
+void			hostUseRealClock(void);
+extern void		(*hostYieldHook)(void);			// called by yield() and delay()
+extern void		(*hostDigitalWriteHook)(int pin, int value);
+
+
+class Print
+	{
+		public:
+			virtual size_t	write(uint8_t data) = 0;
+			virtual size_t	write(const uint8_t* buffer, size_t size);
+			size_t			write(const char* str)		{ return write((const uint8_t*)str, strlen(str)); }
+			virtual int		availableForWrite(void)		{ return 0; }
+			virtual void	flush(void)					{}
+
+			size_t			print(const char* str)		{ return write(str); }
+			size_t			print(char c)				{ return write((uint8_t)c); }
+			size_t			print(long value, int base = DEC);
+			size_t			print(unsigned long value, int base = DEC);
+			size_t			print(int value, int base = DEC)			{ return print((long)value, base); }
+			size_t			print(unsigned int value, int base = DEC)	{ return print((unsigned long)value, base); }
+			size_t			println(void)				{ return write("\r\n"); }
+			template <class T> size_t	println(T value)				{ size_t n = print(value); return n + println(); }
+			template <class T> size_t	println(T value, int base)	{ size_t n = print(value, base); return n + println(); }
+	};
+
+
+class Stream : public Print
+	{
+		public:
+			Stream(void) : timeout(1000) {}
+
+			virtual int		available(void) = 0;
+			virtual int		read(void) = 0;
+			virtual int		peek(void) = 0;
+			void			setTimeout(unsigned long ms)	{ timeout = ms; }
+			size_t			readBytes(char* buffer, size_t size);
+
+		protected:
+			unsigned long	timeout;
+	};
+
+
+class HardwareSerial : public Stream
+	{
+		public:
+			HardwareSerial(void) : device(NULL), baudrate(0) {}
+
+			void			attach(Stream* device)		{ this->device = device; }
+			void			begin(unsigned long baud)	{ baudrate = baud; }
+			void			end(void)					{ baudrate = 0; }
+			int				available(void)				{ return (device != NULL) ? device->available() : 0; }
+			int				read(void)					{ return (device != NULL) ? device->read() : -1; }
+			int				peek(void)					{ return (device != NULL) ? device->peek() : -1; }
+			void			flush(void)					{ if (device != NULL) device->flush(); }
+			size_t			write(uint8_t data)			{ return (device != NULL) ? device->write(data) : 1; }
+			size_t			write(const uint8_t* buffer, size_t size)	{ return (device != NULL) ? device->write(buffer, size) : size; }
+			using Print::write;
+
+		private:
+			Stream*			device;
+			unsigned long	baudrate;
+	};
+
+extern HardwareSerial	Serial, Serial1, Serial2, Serial3, Serial4, Serial5;
+
+
+#endif	// of arduino_h
@@ -0,0 +1,343 @@
+/* posix_serial.cpp file
+ *
+ * for host PC (Linux)
+ *
+ * Stream on a POSIX serial device
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <asm/termbits.h>			// termios2.  <termios.h> can not be used with this
+#include <sys/ioctl.h>
+#else
+#include <termios.h>
+#include <sys/ioctl.h>
+#endif
+#include "posix_serial.h"
+
+
+PosixSerial*	PosixSerial::directionPort = NULL;
+
+
+//****************************************************************************
+//	PosixSerial::PosixSerial / ~PosixSerial
+//		return :		none
+//		parameter :	none
+//
+//		Constructor / Destructor
+//		2026/10/19 : add POSIX serial port
+//****************************************************************************
+PosixSerial::PosixSerial(void)
+{
+	fd = -1;
+	dirPin = -1;
+	rxHead = 0;
+	rxTail = 0;
+	pthread_mutex_init(&writeLock, NULL);
+}
+
+PosixSerial::~PosixSerial(void)
+{
+	close();
+	pthread_mutex_destroy(&writeLock);
+}
+
+
+//****************************************************************************
+//	PosixSerial::open
+//		return :		true if the device is opened
+//		parameter :	device		path of the device.  (/dev/ttyUSB0 etc.)
+//					baudrate	baudrate.  kXBusBaudrate for XBus
+//
+//		open the device in the raw mode with 8N1 and no flow control
+//		2026/10/19 : add POSIX serial port
+//****************************************************************************
+bool PosixSerial::open(const char* device, unsigned long baudrate)
+{
+	close();
+
+	fd = ::open(device, O_RDWR | O_NOCTTY | O_NONBLOCK);
+	if (fd < 0)
+	{
+		perror(device);
+		return false;
+	}
+
+	if (! setBaudrate(baudrate))
+	{
+		perror(device);
+		close();
+		return false;
+	}
+
+	rxHead = 0;
+	rxTail = 0;
+	setRTS(false);
+	return true;
+}
+
+
+//****************************************************************************
+//	PosixSerial::close
+//		return :		none
+//		parameter :	none
+//
+//		2026/10/19 : add POSIX serial port
+//****************************************************************************
+void PosixSerial::close(void)
+{
+	if (fd < 0)
+		return;
+
+	::close(fd);
+	fd = -1;
+	if (directionPort == this)
+	{
+		hostDigitalWriteHook = NULL;
+		directionPort = NULL;
+	}
+}
+
+
+//****************************************************************************
+//	PosixSerial::setBaudrate
+//		return :		true if the port is set up
+//		parameter :	baudrate	baudrate
+//
+//		raw mode, 8N1, no flow control.  VMIN = 0 and VTIME = 0 with O_NONBLOCK
+//		2026/10/19 : add POSIX serial port
+//****************************************************************************
+bool PosixSerial::setBaudrate(unsigned long baudrate)
+{
+#if defined(__linux__)
+	struct termios2		tio;
+
+	if (ioctl(fd, TCGETS2, &tio) < 0)
+		return false;
+
+	tio.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL | IXON | IXOFF | IXANY);
+	tio.c_oflag &= ~OPOST;
+	tio.c_lflag &= ~(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
+	tio.c_cflag &= ~(CSIZE | PARENB | CSTOPB | CRTSCTS | CBAUD | (CBAUD << IBSHIFT));
+	tio.c_cflag |= CS8 | CLOCAL | CREAD | BOTHER | (BOTHER << IBSHIFT);
+	tio.c_ispeed = baudrate;
+	tio.c_ospeed = baudrate;
+	tio.c_cc[VMIN] = 0;
+	tio.c_cc[VTIME] = 0;
+
+	return ioctl(fd, TCSETS2, &tio) == 0;
+#else
+	struct termios		tio;
+
+	if (tcgetattr(fd, &tio) < 0)
+		return false;
+
+	cfmakeraw(&tio);
+	tio.c_cflag &= ~(CSTOPB | CRTSCTS);
+	tio.c_cflag |= CLOCAL | CREAD;
+	tio.c_cc[VMIN] = 0;
+	tio.c_cc[VTIME] = 0;
+	if (cfsetspeed(&tio, baudrate) < 0)
+		return false;
+
+	return tcsetattr(fd, TCSANOW, &tio) == 0;
+#endif
+}
+
+
+//****************************************************************************
+//	PosixSerial::setDirectionPin
+//		return :		none
+//		parameter :	pin			direction pin number given to XBusServoEx
+//
+//		digitalWrite(pin, LOW) (TX) asserts RTS and digitalWrite(pin, HIGH)
+//		(RX) negates it.  only one port can have the direction pin.
+//		XBusServoEx calls flush() before turning the bus to RX, but tcdrain()
+//		of some USB adapters returns before the last byte leaves the wire.
+//		use the adapter with the automatic direction control for those
+//		2026/10/19 : add POSIX serial port
+//****************************************************************************
+void PosixSerial::setDirectionPin(int pin)
+{
+	dirPin = pin;
+	directionPort = this;
+	hostDigitalWriteHook = directionHook;
+}
+
+void PosixSerial::directionHook(int pin, int value)
+{
+	if ((directionPort != NULL) && (pin == directionPort->dirPin))
+		directionPort->setRTS(value == LOW);
+}
+
+
+//****************************************************************************
+//	PosixSerial::setRTS
+//		return :		none
+//		parameter :	on			true to assert RTS
+//
+//		the pseudo terminal has no RTS, and the error is ignored
+//		2026/10/19 : add POSIX serial port
+//****************************************************************************
+void PosixSerial::setRTS(bool on)
+{
+	int		bits = TIOCM_RTS;
+
+	if (fd >= 0)
+		ioctl(fd, on ? TIOCMBIS : TIOCMBIC, &bits);
+}
+
+
+//****************************************************************************
+//	PosixSerial::fill
+//		return :		none
+//		parameter :	none
+//
+//		move the received bytes to rxBuffer without blocking
+//		2026/10/19 : add POSIX serial port
+//****************************************************************************
+void PosixSerial::fill(void)
+{
+	struct pollfd	pfd;
+	ssize_t			size;
+
+	if (fd < 0)
+		return;
+
+	if (rxHead == rxTail)
+	{
+		rxHead = 0;
+		rxTail = 0;
+	}
+	if (rxTail >= kPosixSerialBufferSize)
+		return;
+
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+	if ((poll(&pfd, 1, 0) <= 0) || ((pfd.revents & POLLIN) == 0))
+		return;
+
+	size = ::read(fd, rxBuffer + rxTail, kPosixSerialBufferSize - rxTail);
+	if (size > 0)
+		rxTail += size;
+}
+
+
+//****************************************************************************
+//	PosixSerial::waitReadable
+//		return :		true if some bytes are received
+//		parameter :	msec		max time to wait
+//
+//		sleep until the byte comes.  use this in hostYieldHook not to spin
+//		2026/10/19 : add POSIX serial port
+//****************************************************************************
+bool PosixSerial::waitReadable(int msec)
+{
+	struct pollfd	pfd;
+
+	if (rxHead != rxTail)
+		return true;
+	if (fd < 0)
+		return false;
+
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+	return (poll(&pfd, 1, msec) > 0) && ((pfd.revents & POLLIN) != 0);
+}
+
+
+//****************************************************************************
+//	PosixSerial::available / read / peek
+//		return :		same as Stream
+//		parameter :	none
+//
+//		2026/10/19 : add POSIX serial port
+//****************************************************************************
+int PosixSerial::available(void)
+{
+	fill();
+	return rxTail - rxHead;
+}
+
+int PosixSerial::read(void)
+{
+	if (rxHead == rxTail)
+		fill();
+	if (rxHead == rxTail)
+		return -1;
+
+	return rxBuffer[rxHead++];
+}
+
+int PosixSerial::peek(void)
+{
+	if (rxHead == rxTail)
+		fill();
+	if (rxHead == rxTail)
+		return -1;
+
+	return rxBuffer[rxHead];
+}
+
+
+//****************************************************************************
+//	PosixSerial::write
+//		return :		bytes written
+//		parameter :	buffer		data to send
+//					size		size of data
+//
+//		write all bytes before the other thread writes
+//		2026/10/19 : add POSIX serial port
+//****************************************************************************
+size_t PosixSerial::write(const uint8_t* buffer, size_t size)
+{
+	struct pollfd	pfd;
+	size_t			written = 0;
+	ssize_t			result;
+
+	if (fd < 0)
+		return 0;
+
+	pthread_mutex_lock(&writeLock);
+	while (written < size)
+	{
+		result = ::write(fd, buffer + written, size - written);
+		if (result > 0)
+			written += result;
+		else if ((result < 0) && (errno != EAGAIN) && (errno != EINTR))
+			break;
+		else
+		{
+			pfd.fd = fd;
+			pfd.events = POLLOUT;
+			poll(&pfd, 1, 10);
+		}
+	}
+	pthread_mutex_unlock(&writeLock);
+
+	return written;
+}
+
+
+//****************************************************************************
+//	PosixSerial::flush
+//		return :		none
+//		parameter :	none
+//
+//		wait until all bytes are sent
+//		2026/10/19 : add POSIX serial port
+//****************************************************************************
+void PosixSerial::flush(void)
+{
+	if (fd < 0)
+		return;
+
+#if defined(__linux__)
+	ioctl(fd, TCSBRK, 1);						// tcdrain()
+#else
+	tcdrain(fd);
+#endif
+}
@@ -0,0 +1,64 @@
+/* posix_serial.h file
+ *
+ * for host PC (Linux)
+ *
+ * Stream on a POSIX serial device (USB-UART adapter or pseudo terminal)
+ * for XBusServoEx compiled for the host.  attach it to Serial of the host
+ * shim with Serial.attach().
+ *
+ * the device is opened in the raw mode with 8N1 and the given baudrate.
+ * 250000 baud is set with termios2 (BOTHER) on Linux.  the reads never block:
+ * available() and read() look the device with poll() of zero timeout.
+ * setDirectionPin() maps digitalWrite() of the direction pin of XBusServoEx
+ * to RTS of the device (asserted while sending) for the adapters whose RTS
+ * drives the driver enable.  the write is atomic for each call, so the frame
+ * thread and the main thread never mix their packets
+ */
+
+#ifndef posix_serial_h
+#define posix_serial_h
+#include <pthread.h>
+#include "arduino.h"
+
+#define	kPosixSerialBufferSize		256
+
+
+class PosixSerial : public Stream
+	{
+		public:
+			PosixSerial(void);
+			~PosixSerial(void);
+
+		public:
+			bool			open(const char* device, unsigned long baudrate);
+			void			close(void);
+			bool			isOpen(void)				{ return fd >= 0; }
+			void			setDirectionPin(int pin);
+			void			setRTS(bool on);
+			bool			waitReadable(int msec);
+
+			int				available(void);
+			int				read(void);
+			int				peek(void);
+			size_t			write(uint8_t data)			{ return write(&data, 1); }
+			size_t			write(const uint8_t* buffer, size_t size);
+			void			flush(void);
+			using Print::write;
+
+		private:
+			int				fd;
+			int				dirPin;						// pin number given to XBusServoEx.  -1 if no RTS control
+			pthread_mutex_t	writeLock;
+			uint8_t			rxBuffer[kPosixSerialBufferSize];
+			int				rxHead;
+			int				rxTail;
+
+			bool			setBaudrate(unsigned long baudrate);
+			void			fill(void);
+
+			static PosixSerial*	directionPort;
+			static void		directionHook(int pin, int value);
+	};
+
+
+#endif	// of posix_serial_h
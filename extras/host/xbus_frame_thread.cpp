@@ -0,0 +1,183 @@
+/* xbus_frame_thread.cpp file
+ *
+ * for host PC (Linux)
+ *
+ * thread sending the channel data packet every kXBusInterval on the host
+ */
+
+#include <time.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include "xbus_frame_thread.h"
+
+
+//****************************************************************************
+//	XBusFrameThread::XBusFrameThread
+//		return :		none
+//		parameter :	servo		XBusServoEx to send the frames
+//
+//		Constructor / Destructor
+//		2026/10/19 : add host frame thread
+//****************************************************************************
+XBusFrameThread::XBusFrameThread(XBusServoEx& servo)
+{
+	pthread_mutex_init(&busLock, NULL);
+	xbus = &servo;
+	running = false;
+	realTime = false;
+	frameCount = 0;
+	skipCount = 0;
+	maxJitter = 0;
+}
+
+XBusFrameThread::~XBusFrameThread(void)
+{
+	stop();
+	pthread_mutex_destroy(&busLock);
+}
+
+
+//****************************************************************************
+//	XBusFrameThread::start
+//		return :		true if the thread is started
+//		parameter :	priority	SCHED_FIFO priority (1 to 99).  0 for the normal thread
+//
+//		with priority, the memory is locked and the thread runs with SCHED_FIFO.
+//		it needs CAP_SYS_NICE (or rtprio in limits.conf).  without the
+//		permission the thread runs as the normal thread and isRealTime() is false
+//		2026/10/19 : add host frame thread
+//****************************************************************************
+bool XBusFrameThread::start(int priority)
+{
+	pthread_attr_t		attr;
+	struct sched_param	param;
+
+	if (running)
+		return false;
+
+	running = true;
+	realTime = false;
+	if (priority > 0)
+	{
+		mlockall(MCL_CURRENT | MCL_FUTURE);
+
+		pthread_attr_init(&attr);
+		pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+		pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+		param.sched_priority = priority;
+		pthread_attr_setschedparam(&attr, &param);
+		realTime = (pthread_create(&thread, &attr, threadEntry, this) == 0);
+		pthread_attr_destroy(&attr);
+		if (realTime)
+			return true;
+	}
+
+	if (pthread_create(&thread, NULL, threadEntry, this) != 0)
+	{
+		running = false;
+		return false;
+	}
+
+	return true;
+}
+
+
+//****************************************************************************
+//	XBusFrameThread::stop
+//		return :		none
+//		parameter :	none
+//
+//		2026/10/19 : add host frame thread
+//****************************************************************************
+void XBusFrameThread::stop(void)
+{
+	if (! running)
+		return;
+
+	running = false;
+	pthread_join(thread, NULL);
+}
+
+
+//****************************************************************************
+//	XBusFrameThread::lock / unlock
+//		return :		none
+//		parameter :	none
+//
+//		hold the bus for the commands.  lock() returns after the echo of the
+//		frame being sent.  keep the lock short, the frames are skipped
+//		2026/10/19 : add host frame thread
+//****************************************************************************
+void XBusFrameThread::lock(void)
+{
+	pthread_mutex_lock(&busLock);
+}
+
+void XBusFrameThread::unlock(void)
+{
+	pthread_mutex_unlock(&busLock);
+}
+
+
+//****************************************************************************
+//	XBusFrameThread::threadEntry / run
+//		return :		none
+//		parameter :	param		XBusFrameThread
+//
+//		sleep to the absolute time of the next frame with clock_nanosleep so
+//		that the frame period does not drift with the time to send the frame.
+//		the bus is held until the echo of the frame comes
+//		2026/10/19 : add host frame thread
+//****************************************************************************
+void* XBusFrameThread::threadEntry(void* param)
+{
+	((XBusFrameThread*)param)->run();
+	return NULL;
+}
+
+void XBusFrameThread::run(void)
+{
+	struct timespec		next;
+	struct timespec		now;
+	struct timespec		echoWait;
+	long				jitter;
+
+	echoWait.tv_sec = 0;
+	echoWait.tv_nsec = kXBusEchoLatency * 1000L;
+
+	clock_gettime(CLOCK_MONOTONIC, &next);
+	while (running)
+	{
+		next.tv_nsec += kXBusInterval * 1000000L;
+		if (next.tv_nsec >= 1000000000L)
+		{
+			next.tv_nsec -= 1000000000L;
+			next.tv_sec++;
+		}
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) != 0)
+			;
+
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		jitter = (now.tv_sec - next.tv_sec) * 1000000L + (now.tv_nsec - next.tv_nsec) / 1000;
+		if ((jitter > 0) && ((unsigned long)jitter > maxJitter))
+			maxJitter = jitter;
+
+		// start the schedule again after the long stop, not to send the frames in a burst
+		if (jitter > kXBusInterval * 1000L)
+			next = now;
+
+		if (pthread_mutex_trylock(&busLock) != 0)
+		{
+			skipCount++;
+			continue;
+		}
+
+		xbus->sendChannelDataPacket();
+		frameCount++;
+
+		Serial.flush();
+		nanosleep(&echoWait, NULL);
+		pthread_mutex_unlock(&busLock);
+	}
+}
+
@@ -0,0 +1,53 @@
+/* xbus_frame_thread.h file
+ *
+ * for host PC (Linux)
+ *
+ * thread sending the channel data packet every kXBusInterval on the host.
+ * the host shim has begin() and Serial only, so the frames go to Serial.
+ * it takes the place of the timer interrupt of the Arduino sketch: the
+ * setpoints are published by setServo() with the seqlock.
+ * the echo of the USB-UART adapter comes a few mSec late, so the commands
+ * from the other threads are put between lock() and unlock().  lock() waits
+ * until the echo of the frame sent has come, and the frames are skipped
+ * while the lock is held as with commandBusy
+ */
+
+#ifndef xbus_frame_thread_h
+#define xbus_frame_thread_h
+#include <pthread.h>
+#include "XBusServoEx.h"
+
+#define	kXBusEchoLatency			2000			// uSec.  latency of the echo through the adapter
+
+class XBusFrameThread
+	{
+		public:
+			XBusFrameThread(XBusServoEx& servo);
+			~XBusFrameThread(void);
+
+		public:
+			bool			start(int priority);
+			void			stop(void);
+			void			lock(void);
+			void			unlock(void);
+			bool			isRealTime(void)			{ return realTime; }
+			unsigned long	getFrameCount(void)			{ return frameCount; }
+			unsigned long	getSkipCount(void)			{ return skipCount; }
+			unsigned long	getMaxJitter(void)			{ return maxJitter; }
+
+		private:
+			XBusServoEx*	xbus;
+			pthread_t		thread;
+			pthread_mutex_t	busLock;					// held by the frame until its echo comes, or by the command
+			volatile bool	running;
+			bool			realTime;					// running with SCHED_FIFO
+			volatile unsigned long	frameCount;
+			volatile unsigned long	skipCount;			// frames skipped by the command
+			volatile unsigned long	maxJitter;			// uSec
+
+			static void*	threadEntry(void* param);
+			void			run(void);
+	};
+
+
+#endif	// of xbus_frame_thread_h
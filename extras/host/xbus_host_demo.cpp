@@ -0,0 +1,140 @@
+/* xbus_host_demo.cpp file
+ *
+ * for host PC (Linux)
+ *
+ * drive the XBus servos from Linux through the USB-UART adapter with
+ * XBusServoEx, PosixSerial and XBusFrameThread.
+ *
+ *	build :	g++ -O2 -pthread -I extras/host -I src -o xbus_host_demo extras/host/xbus_host_demo.cpp
+ *				extras/host/posix_serial.cpp extras/host/xbus_frame_thread.cpp extras/host/arduino.cpp
+ *				src/XBusServoEx.cpp src/XBusRxParser.cpp src/XBusRecordRing.cpp
+ *	usage :	xbus_host_demo [-n numOfServo] [-t seconds] [-p priority] [-r] device
+ *
+ * the servos from ID 1 to numOfServo move with sine wave from the frame
+ * thread, and the main thread sets and reads back the neutral of a servo
+ * every 500 mSec holding the bus with XBusFrameThread::lock().  -p runs the frame thread with
+ * SCHED_FIFO, and -r drives RTS as the direction of the bus.
+ * to try it without the servos :
+ *		xbus_pty_servo -n 4 -t 12 -l /tmp/xbus &
+ *		xbus_host_demo -n 4 -t 10 /tmp/xbus
+ *
+ *	exit code :	0 ok, 1 command error, 3 bad parameter or device
+ */
+
+#include <unistd.h>
+#include "XBusServoEx.h"
+#include "posix_serial.h"
+#include "xbus_frame_thread.h"
+
+#define	kDirPin					2				// direction pin given to XBusServoEx for RTS
+
+
+int main(int argc, char* argv[])
+{
+	int				numOfServo = 4;
+	int				seconds = 10;
+	int				priority = 0;
+	bool			useRTS = false;
+	int				opt;
+	PosixSerial		port;
+	unsigned long	start;
+	unsigned long	lastCommand;
+	unsigned long	commands = 0;
+	unsigned long	errors = 0;
+	int				id;
+
+	while ((opt = getopt(argc, argv, "n:t:p:r")) != -1)
+	{
+		switch (opt)
+		{
+			case 'n':
+				numOfServo = atoi(optarg);
+				break;
+			case 't':
+				seconds = atoi(optarg);
+				break;
+			case 'p':
+				priority = atoi(optarg);
+				break;
+			case 'r':
+				useRTS = true;
+				break;
+			default:
+				optind = argc + 1;
+				break;
+		}
+	}
+	if ((optind != argc - 1) || (numOfServo < 1) || (numOfServo > kXBusMaxServoNum))
+	{
+		fprintf(stderr, "usage : xbus_host_demo [-n numOfServo] [-t seconds] [-p priority] [-r] device\n");
+		return 3;
+	}
+
+	hostUseRealClock();
+	if (! port.open(argv[optind], kXBusBaudrate))
+		return 3;
+	if (useRTS)
+		port.setDirectionPin(kDirPin);
+	Serial.attach(&port);
+
+	// the direction pin is given without -r too, or the commands are TX only.
+	// digitalWrite() does nothing for the adapter with the automatic direction control
+	XBusServoEx		xbus(kDirPin, numOfServo);
+	XBusFrameThread	frameThread(xbus);
+
+	xbus.begin();
+	for (id = 1; id <= numOfServo; id++)
+		xbus.addServo(id, kXbusServoNeutral);
+
+	if (! frameThread.start(priority))
+	{
+		fprintf(stderr, "can not start the frame thread\n");
+		return 3;
+	}
+	if ((priority > 0) && ! frameThread.isRealTime())
+		fprintf(stderr, "no permission for SCHED_FIFO.  running as the normal thread\n");
+
+	start = millis();
+	lastCommand = start;
+	while (millis() - start < (unsigned long)seconds * 1000)
+	{
+		double		phase = (millis() - start) / 1000.0;
+
+		for (id = 1; id <= numOfServo; id++)
+			xbus.setServo(id, kXbusServoNeutral + (int)(8000 * sin(phase + id)));
+
+		if (millis() - lastCommand >= 500)
+		{
+			int			neutral = (int)(commands % 200) - 100;
+			int			value = 0;
+			XBusError	result;
+
+			lastCommand += 500;
+			id = commands % numOfServo + 1;
+			commands++;
+
+			frameThread.lock();
+			result = xbus.setCommand(id, kXBusOrder_2_Neutral, &neutral);
+			if (result == kXBusError_NoError)
+				result = xbus.getCommand(id, kXBusOrder_2_Neutral, &value);
+			frameThread.unlock();
+			if ((result != kXBusError_NoError) || (value != neutral))
+			{
+				errors++;
+				printf("servo %d : error %d  value %d / %d\n", id, result, value, neutral);
+			}
+		}
+
+		delay(2);
+	}
+
+	frameThread.stop();
+	xbus.end();
+	port.close();
+
+	printf("frames %lu  skipped %lu  max jitter %lu uSec  commands %lu  errors %lu%s\n",
+			frameThread.getFrameCount(), frameThread.getSkipCount(), frameThread.getMaxJitter(), commands, errors,
+			frameThread.isRealTime() ? "  (SCHED_FIFO)" : "");
+
+	return (errors == 0) ? 0 : 1;
+}
@@ -0,0 +1,292 @@
+/* xbus_pty_servo.cpp file
+ *
+ * for host PC (Linux)
+ *
+ * simulated XBus servos on a pseudo terminal pair.  the host program with
+ * PosixSerial opens the slave side printed at the start as if it is the
+ * USB-UART adapter on the bus.
+ *
+ *	build :	g++ -O2 -I extras/host -I src -o xbus_pty_servo extras/host/xbus_pty_servo.cpp
+ *				extras/host/arduino.cpp src/XBusServoEx.cpp src/XBusRxParser.cpp src/XBusRecordRing.cpp
+ *	usage :	xbus_pty_servo [-n numOfServo] [-t seconds] [-l linkPath]
+ *
+ * all bytes received come back as the echo of the half duplex bus.  the
+ * servos from ID 1 to numOfServo keep the values set by the commands and
+ * return them to get, and the others never respond.  the channel data
+ * packets are checked with CRC, and the frame count, the min / max frame
+ * interval and the position of the servos are printed every second.
+ * -l makes the symbolic link to the slave side.  it ends after the seconds
+ * given by -t (0 for ever)
+ *
+ *	exit code :	0 ok, 1 CRC error found, 3 bad parameter or pty error
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <termios.h>
+#include <time.h>
+#include "XBusServoEx.h"
+
+
+static uint64_t nowMicros(void)
+{
+	struct timespec		now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+
+//****************************************************************************
+//	PtyServo
+//		the servos on the master side of the pseudo terminal
+//****************************************************************************
+class PtyServo
+	{
+		public:
+			PtyServo(int fd, int numOfServo);
+
+			void			receive(const uint8_t* data, size_t size, uint64_t time);
+			void			report(void);
+			unsigned int	crcErrors(void)				{ return parser.crcErrorCount(); }
+
+		private:
+			int				fd;
+			int				numOfServo;
+			uint8_t			parserBuffer[kXBusMaxPacketSize];
+			XBusRxParser	parser;
+			int				registers[kXBusMaxServoNum + 1][256];
+			unsigned int	position[kXBusMaxServoNum + 1];
+			unsigned long	frames;
+			unsigned long	commands;
+			uint64_t		lastFrame;
+			uint64_t		minInterval;
+			uint64_t		maxInterval;
+
+			void			frame(const uint8_t* packet, size_t size, uint64_t time);
+			void			respond(const uint8_t* command, size_t size);
+	};
+
+
+PtyServo::PtyServo(int fd, int numOfServo)
+	: parser(parserBuffer, sizeof(parserBuffer))
+{
+	this->fd = fd;
+	this->numOfServo = numOfServo;
+	memset(registers, 0, sizeof(registers));
+	memset(position, 0, sizeof(position));
+	frames = 0;
+	commands = 0;
+	lastFrame = 0;
+	minInterval = ~0ULL;
+	maxInterval = 0;
+}
+
+
+void PtyServo::receive(const uint8_t* data, size_t size, uint64_t time)
+{
+	size_t		index;
+
+	// echo of the half duplex bus
+	if (write(fd, data, size) != (ssize_t)size)
+		perror("echo");
+
+	for (index = 0; index < size; index++)
+	{
+		bool	completed;
+
+		for (completed = parser.feed(data[index]); completed; completed = parser.next())
+		{
+			if (parser.packet()[0] == kXBusCmd_ModeA)
+				frame(parser.packet(), parser.packetSize(), time);
+			else
+				respond(parser.packet(), parser.packetSize());
+		}
+	}
+}
+
+
+void PtyServo::frame(const uint8_t* packet, size_t size, uint64_t time)
+{
+	size_t		offset;
+
+	if (lastFrame != 0)
+	{
+		uint64_t	interval = time - lastFrame;
+
+		if (interval < minInterval)
+			minInterval = interval;
+		if (interval > maxInterval)
+			maxInterval = interval;
+	}
+	lastFrame = time;
+	frames++;
+
+	for (offset = 4; offset + 4 < size; offset += 4)
+		if (packet[offset] <= kXBusMaxServoNum)
+			position[packet[offset]] = (packet[offset + 2] << 8) | packet[offset + 3];
+}
+
+
+void PtyServo::respond(const uint8_t* command, size_t size)
+{
+	uint8_t		response[kXBusCmdPacketMaxSize];
+	uint8_t		id = command[3];
+	uint8_t		order = command[4];
+	int			valueSize = command[1] - 3;
+
+	if ((size < 7) || (size > sizeof(response)) || ((command[0] != kXBusCmd_Set) && (command[0] != kXBusCmd_Get)))
+		return;
+
+	commands++;
+	if ((id == 0) || (id > numOfServo))
+		return;
+
+	memcpy(response, command, size);
+	if (command[0] == kXBusCmd_Set)
+		registers[id][order] = (valueSize == 1) ? command[5] : ((command[5] << 8) | command[6]);
+	else if (valueSize == 1)
+		response[5] = registers[id][order];
+	else
+	{
+		response[5] = registers[id][order] >> 8;
+		response[6] = registers[id][order];
+	}
+	response[size - 1] = XBusServoEx::crc8(response, size - 1);
+	if (write(fd, response, size) != (ssize_t)size)
+		perror("response");
+}
+
+
+void PtyServo::report(void)
+{
+	int		id;
+
+	printf("frames %lu  interval %llu - %llu uSec  commands %lu  crc errors %u  position",
+			frames, (unsigned long long)((maxInterval > 0) ? minInterval : 0), (unsigned long long)maxInterval,
+			commands, parser.crcErrorCount());
+	for (id = 1; id <= numOfServo; id++)
+		printf(" %u", position[id]);
+	printf("\n");
+	fflush(stdout);
+
+	minInterval = ~0ULL;
+	maxInterval = 0;
+}
+
+
+//****************************************************************************
+//	openPty
+//		return :		fd of the master side.  -1 if error
+//		parameter :	slaveFd		fd of the slave side kept open with the raw mode
+//
+//		the slave side must be raw before the host program opens it, or the
+//		line discipline echoes the responses back to the servos
+//****************************************************************************
+static int openPty(int* slaveFd)
+{
+	struct termios	tio;
+	int				master;
+
+	master = posix_openpt(O_RDWR | O_NOCTTY);
+	if ((master < 0) || (grantpt(master) < 0) || (unlockpt(master) < 0))
+		return -1;
+
+	*slaveFd = open(ptsname(master), O_RDWR | O_NOCTTY);
+	if (*slaveFd < 0)
+		return -1;
+
+	tcgetattr(*slaveFd, &tio);
+	cfmakeraw(&tio);
+	tcsetattr(*slaveFd, TCSANOW, &tio);
+
+	return master;
+}
+
+
+int main(int argc, char* argv[])
+{
+	int				numOfServo = 4;
+	int				seconds = 0;
+	const char*		linkPath = NULL;
+	int				master;
+	int				slave;
+	int				opt;
+	uint64_t		start;
+	uint64_t		lastReport;
+
+	while ((opt = getopt(argc, argv, "n:t:l:")) != -1)
+	{
+		switch (opt)
+		{
+			case 'n':
+				numOfServo = atoi(optarg);
+				break;
+			case 't':
+				seconds = atoi(optarg);
+				break;
+			case 'l':
+				linkPath = optarg;
+				break;
+			default:
+				fprintf(stderr, "usage : xbus_pty_servo [-n numOfServo] [-t seconds] [-l linkPath]\n");
+				return 3;
+		}
+	}
+	if ((numOfServo < 1) || (numOfServo > kXBusMaxServoNum))
+		return 3;
+
+	master = openPty(&slave);
+	if (master < 0)
+	{
+		perror("pty");
+		return 3;
+	}
+
+	if (linkPath != NULL)
+	{
+		unlink(linkPath);
+		if (symlink(ptsname(master), linkPath) < 0)
+		{
+			perror(linkPath);
+			return 3;
+		}
+	}
+	printf("slave %s  servos 1 to %d\n", ptsname(master), numOfServo);
+	fflush(stdout);
+
+	PtyServo		servo(master, numOfServo);
+
+	start = nowMicros();
+	lastReport = start;
+	while ((seconds == 0) || (nowMicros() - start < (uint64_t)seconds * 1000000))
+	{
+		struct pollfd	pfd;
+		uint8_t			data[256];
+		ssize_t			size;
+
+		pfd.fd = master;
+		pfd.events = POLLIN;
+		if (poll(&pfd, 1, 100) > 0)
+		{
+			size = read(master, data, sizeof(data));
+			if (size > 0)
+				servo.receive(data, size, nowMicros());
+		}
+
+		if (nowMicros() - lastReport >= 1000000)
+		{
+			servo.report();
+			lastReport += 1000000;
+		}
+	}
+
+	if (linkPath != NULL)
+		unlink(linkPath);
+	close(slave);
+	close(master);
+
+	return (servo.crcErrors() == 0) ? 0 : 1;
+}
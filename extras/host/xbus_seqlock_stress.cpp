@@ -0,0 +1,198 @@
+/* xbus_seqlock_stress.cpp file
+ *
+ * for host PC (Linux)
+ *
+ * stress test of the sequence counter (seqlock) between the thread writing
+ * the servo values and the thread sending the channel data packets, as the
+ * application and the frame sender on the other core or in the interrupt.
+ *
+ *	build :	g++ -O2 -pthread -I extras/host -I src -o xbus_seqlock_stress extras/host/xbus_seqlock_stress.cpp
+ *				extras/host/arduino.cpp src/XBusServoEx.cpp src/XBusRxParser.cpp src/XBusRecordRing.cpp
+ *	usage :	xbus_seqlock_stress [-n numOfServo] [-t seconds]
+ *
+ * the writer sets all servos to the same value in one update with
+ * setServosByIndex, and changes the rate class and the slew rate limit of
+ * the servos in the middle (neither of them changes the values sent).
+ * the sender checks every packet: the CRC, the servo IDs and that all
+ * servos in the packet have the same value whose high byte is the
+ * complement of the low byte.  a torn packet means that the writer and
+ * the sender were not separated by the sequence counter.
+ *
+ *	exit code :	0 ok, 1 torn packet, 3 bad parameter
+ */
+
+#include <unistd.h>
+#include <pthread.h>
+#include "XBusServoEx.h"
+
+
+// the channel data packets sent to Serial are checked here
+class PacketChecker : public Stream
+	{
+		public:
+			PacketChecker(void)		{ numOfServo = 0; packets = 0; torn = 0; }
+
+		public:
+			size_t			write(uint8_t data)		{ return write(&data, 1); }
+			size_t			write(const uint8_t* buffer, size_t size);
+			int				available(void)			{ return 0; }
+			int				read(void)				{ return -1; }
+			int				peek(void)				{ return -1; }
+
+			int				numOfServo;
+			unsigned long	packets;
+			unsigned long	torn;
+	};
+
+
+size_t PacketChecker::write(const uint8_t* buffer, size_t size)
+{
+	int			count;
+	int			index;
+	int			value = -1;
+	bool		ok = true;
+
+	packets++;
+
+	count = (size - 5) / 4;
+	if ((size < 9) || (buffer[0] != kXBusCmd_ModeA) || (buffer[1] != size - 3)
+			|| ((size - 5) % 4 != 0) || (count > numOfServo))
+		ok = false;
+
+	if (ok && (XBusServoEx::crc8((uint8_t*)buffer, size - 1) != buffer[size - 1]))
+		ok = false;
+
+	for (index = 0; ok && (index < count); index++)
+	{
+		const uint8_t*	data = &buffer[4 + index * 4];
+
+		if ((data[0] < 1) || (data[0] > numOfServo) || (data[2] != (uint8_t)~data[3]))
+			ok = false;
+		else if (value < 0)
+			value = data[2];
+		else if (data[2] != value)
+			ok = false;
+	}
+
+	if (! ok)
+		torn++;
+
+	return size;
+}
+
+
+static XBusServoEx		xbus(-1, kXBusMaxServoNum);
+static PacketChecker	checker;
+static volatile bool	running;
+static unsigned long	writes;
+static unsigned long	settings;
+
+
+//****************************************************************************
+//	writer
+//		return :		NULL
+//		parameter :	param		not used
+//
+//		set all servos to the same value, and change the rate class and the
+//		slew rate limit once in 16 updates
+//		2026/10/19 : add seqlock stress test
+//****************************************************************************
+static void* writer(void* /* param */)
+{
+	uint8_t			values[kXBusMaxServoNum * 2];
+	int				numOfServo = xbus.getNumOfServo();
+	unsigned int	value = 0;
+	int				index;
+
+	while (running)
+	{
+		value = (value + 1) & 0xFF;
+		for (index = 0; index < numOfServo; index++)
+		{
+			values[index * 2] = value;
+			values[index * 2 + 1] = ~value;
+		}
+		xbus.setServosByIndex(0, numOfServo, values);
+		writes++;
+
+		if ((value & 0x0F) == 0)
+		{
+			char	channelID = 1 + (value >> 4) % numOfServo;
+
+			xbus.setServoRate(channelID, (value & 0x10) ? 2 : 1);
+			xbus.setServoLimit(channelID, (value & 0x10) ? 0xFFFF : 0, 0);
+			settings++;
+		}
+	}
+
+	return NULL;
+}
+
+
+//****************************************************************************
+//	sender
+//		return :		NULL
+//		parameter :	param		not used
+//
+//		send the channel data packets back to back
+//		2026/10/19 : add seqlock stress test
+//****************************************************************************
+static void* sender(void* /* param */)
+{
+	while (running)
+		xbus.sendChannelDataPacket();
+
+	return NULL;
+}
+
+
+int main(int argc, char* argv[])
+{
+	int				numOfServo = kXBusMaxServoNum;
+	int				seconds = 2;
+	int				opt;
+	int				id;
+	pthread_t		writeThread;
+	pthread_t		sendThread;
+
+	while ((opt = getopt(argc, argv, "n:t:")) != -1)
+	{
+		switch (opt)
+		{
+			case 'n':
+				numOfServo = atoi(optarg);
+				break;
+			case 't':
+				seconds = atoi(optarg);
+				break;
+			default:
+				optind = argc + 1;
+				break;
+		}
+	}
+	if ((optind != argc) || (numOfServo < 1) || (numOfServo > kXBusMaxServoNum) || (seconds < 1))
+	{
+		fprintf(stderr, "usage : xbus_seqlock_stress [-n numOfServo] [-t seconds]\n");
+		return 3;
+	}
+
+	hostUseRealClock();
+	Serial.attach(&checker);
+	xbus.begin();
+	for (id = 1; id <= numOfServo; id++)
+		xbus.addServo(id, 0x00FF);
+	checker.numOfServo = numOfServo;
+
+	running = true;
+	pthread_create(&sendThread, NULL, sender, NULL);
+	pthread_create(&writeThread, NULL, writer, NULL);
+	sleep(seconds);
+	running = false;
+	pthread_join(writeThread, NULL);
+	pthread_join(sendThread, NULL);
+
+	printf("%d servos, %lu updates, %lu setting changes, %lu packets, %lu torn\n",
+			numOfServo, writes, settings, checker.packets, checker.torn);
+
+	return (checker.torn == 0) ? 0 : 1;
+}
@@ -0,0 +1,417 @@
+/* xbus_trace_replay.cpp file
+ *
+ * for host PC
+ *
+ * replay the trace recorded by XBusServoEx::setTraceRecorder into
+ * XBusServoEx compiled for the host with simulated servos.
+ *
+ *	build :	g++ -O2 -I extras/host -I src -o xbus_trace_replay extras/host/xbus_trace_replay.cpp
+ *				extras/host/arduino.cpp src/XBusServoEx.cpp src/XBusRxParser.cpp src/XBusRecordRing.cpp
+ *	usage :	xbus_trace_replay [-r repeat] [-l maxNSecPerFrame] trace.bin
+ *			xbus_trace_replay -g numOfServo numOfFrame trace.bin
+ *
+ * every channel data packet of the trace is rebuilt from its servo values at
+ * the recorded time, and every command is sent again while the simulated
+ * servos return the recorded response (or nothing for kXBusError_TimeOut and
+ * a broken response for kXBusError_CRCError).  the packets sent and the results
+ * of the commands must be the same as the trace.  the CPU time to build the
+ * channel data packets is measured, so it works as a performance regression
+ * test with -l.  (the packet captured by XBusSniffer is replayed only if it is
+ * the channel data packet.)
+ * -g makes a trace on the host with the simulated servos.  the commands to
+ * the servo numOfServo + 1 end with kXBusError_TimeOut.
+ *
+ *	exit code :	0 ok, 1 the replay is different from the trace,
+ *				2 slower than maxNSecPerFrame, 3 bad parameter or file
+ */
+
+#include <vector>
+#include <chrono>
+#include "XBusServoEx.h"
+#include "XBusRecordRing.h"
+
+
+struct TraceRecord
+{
+	uint8_t					type;
+	unsigned long			time;
+	std::vector<uint8_t>	packet;
+};
+
+
+//****************************************************************************
+//	SimBus
+//		half duplex bus with the simulated servos.  all bytes sent come back
+//		as the echo.  the response is the scripted one if it is given,
+//		otherwise the servos from ID 1 to numOfServo keep the values set and
+//		return them to get
+//****************************************************************************
+class SimBus : public Stream
+	{
+		public:
+			SimBus(int numOfServo) : rxIndex(0), numOfServo(numOfServo), scripted(false), scriptError(kXBusError_NoError) { memset(registers, 0, sizeof(registers)); }
+
+			void			script(const std::vector<uint8_t>& response, XBusError error)
+								{ scripted = true; scriptResponse = response; scriptError = error; }
+			void			unscript(void)				{ scripted = false; }
+
+			int				available(void)				{ return rxQueue.size() - rxIndex; }
+			int				read(void);
+			int				peek(void)					{ return (rxIndex < rxQueue.size()) ? rxQueue[rxIndex] : -1; }
+			size_t			write(uint8_t data)			{ return write(&data, 1); }
+			size_t			write(const uint8_t* buffer, size_t size);
+			using Print::write;
+
+			std::vector<uint8_t>	txLog;
+
+		private:
+			std::vector<uint8_t>	rxQueue;
+			size_t					rxIndex;
+			int						numOfServo;			// servos from ID 1 to respond
+			bool					scripted;
+			std::vector<uint8_t>	scriptResponse;
+			XBusError				scriptError;
+			int						registers[kXBusMaxServoNum + 1][256];
+
+			void			respond(const uint8_t* command, size_t size);
+	};
+
+
+int SimBus::read(void)
+{
+	if (rxIndex < rxQueue.size())
+		return rxQueue[rxIndex++];
+
+	// the time goes while nothing comes
+	hostAdvanceMicros(kXBusByteTime);
+	return -1;
+}
+
+
+size_t SimBus::write(const uint8_t* buffer, size_t size)
+{
+	txLog.insert(txLog.end(), buffer, buffer + size);
+
+	if (rxIndex >= rxQueue.size())
+	{
+		rxQueue.clear();
+		rxIndex = 0;
+	}
+
+	// echo of the half duplex bus
+	rxQueue.insert(rxQueue.end(), buffer, buffer + size);
+	hostAdvanceMicros(size * kXBusByteTime);
+
+	if ((size >= 7) && ((buffer[0] == kXBusCmd_Set) || (buffer[0] == kXBusCmd_Get)) && (buffer[3] != 0))
+		respond(buffer, size);
+
+	return size;
+}
+
+
+void SimBus::respond(const uint8_t* command, size_t size)
+{
+	uint8_t		response[kXBusCmdPacketMaxSize];
+	uint8_t		id = command[3];
+	uint8_t		order = command[4];
+	int			valueSize = command[1] - 3;
+
+	if (scripted)
+	{
+		if (scriptError == kXBusError_TimeOut)
+			return;
+
+		if (scriptError == kXBusError_CRCError)
+		{
+			memcpy(response, command, size);
+			response[size - 1] ^= 0xFF;
+			rxQueue.insert(rxQueue.end(), response, response + size);
+			return;
+		}
+
+		rxQueue.insert(rxQueue.end(), scriptResponse.begin(), scriptResponse.end());
+		return;
+	}
+
+	if (id > numOfServo)
+		return;
+
+	memcpy(response, command, size);
+	if (command[0] == kXBusCmd_Set)
+		registers[id][order] = (valueSize == 1) ? command[5] : ((command[5] << 8) | command[6]);
+	else if (valueSize == 1)
+		response[5] = registers[id][order];
+	else
+	{
+		response[5] = registers[id][order] >> 8;
+		response[6] = registers[id][order];
+	}
+	response[size - 1] = XBusServoEx::crc8(response, size - 1);
+	rxQueue.insert(rxQueue.end(), response, response + size);
+}
+
+
+//****************************************************************************
+//	RecordWriter
+//		Print to a file for XBusRecordRing::dump
+//****************************************************************************
+class RecordWriter : public Print
+	{
+		public:
+			RecordWriter(FILE* file) : file(file) {}
+			size_t			write(uint8_t data)			{ return fwrite(&data, 1, 1, file); }
+			size_t			write(const uint8_t* buffer, size_t size)	{ return fwrite(buffer, 1, size, file); }
+			using Print::write;
+
+		private:
+			FILE*			file;
+	};
+
+
+//****************************************************************************
+//	loadTrace
+//		return :		true if the file is read
+//****************************************************************************
+static bool loadTrace(const char* fileName, std::vector<TraceRecord>& trace)
+{
+	FILE*			in;
+	uint8_t			header[kXBusRecordHeaderSize];
+	TraceRecord		record;
+
+	in = fopen(fileName, "rb");
+	if (in == NULL)
+	{
+		perror(fileName);
+		return false;
+	}
+
+	while (fread(header, 1, kXBusRecordHeaderSize, in) == kXBusRecordHeaderSize)
+	{
+		record.type = header[0];
+		record.time = (unsigned long)header[1] | ((unsigned long)header[2] << 8)
+						| ((unsigned long)header[3] << 16) | ((unsigned long)header[4] << 24);
+		record.packet.resize(header[5]);
+		if (fread(record.packet.data(), 1, header[5], in) != header[5])
+			break;
+		trace.push_back(record);
+	}
+
+	fclose(in);
+	return true;
+}
+
+
+//****************************************************************************
+//	replayFrame
+//		return :		true if the same packet is sent
+//****************************************************************************
+static bool replayFrame(XBusServoEx& xbus, SimBus& bus, const TraceRecord& record, uint64_t* nsec)
+{
+	const std::vector<uint8_t>&	packet = record.packet;
+	size_t						offset;
+
+	if ((packet.size() < 5) || (packet[0] != kXBusCmd_ModeA))
+		return true;
+
+	for (offset = 4; offset + 4 < packet.size(); offset += 4)
+	{
+		unsigned int	value = (packet[offset + 2] << 8) | packet[offset + 3];
+
+		if (xbus.setServo(packet[offset], value) != kXBusError_NoError)
+			xbus.addServo(packet[offset], value);
+	}
+
+	hostSetMicros(record.time);
+	bus.txLog.clear();
+
+	std::chrono::steady_clock::time_point	start = std::chrono::steady_clock::now();
+	xbus.sendChannelDataPacket();
+	*nsec += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+	return bus.txLog == packet;
+}
+
+
+//****************************************************************************
+//	replayCommand
+//		return :		true if the same packet is sent and the result is the same
+//		parameter :	index		index of the command record.  moved to the last
+//								record of the command
+//****************************************************************************
+static bool replayCommand(XBusServoEx& xbus, SimBus& bus, const std::vector<TraceRecord>& trace, size_t* index)
+{
+	const TraceRecord&		command = trace[*index];
+	std::vector<uint8_t>	response;
+	XBusError				expected = kXBusError_NoError;
+	XBusError				result;
+	int						value;
+
+	// the response and the error follow the command
+	while ((*index + 1 < trace.size())
+			&& ((trace[*index + 1].type == kXBusRecord_Response) || (trace[*index + 1].type == kXBusRecord_Error)))
+	{
+		(*index)++;
+		if (trace[*index].type == kXBusRecord_Response)
+			response = trace[*index].packet;
+		else
+			expected = (XBusError)trace[*index].packet[0];
+	}
+
+	if ((command.packet.size() < 7) || (command.packet[1] + 3U != command.packet.size()))
+		return false;
+
+	bus.script(response, expected);
+	bus.txLog.clear();
+	hostSetMicros(command.time);
+
+	// the get command sends the value in the variable as is
+	value = (command.packet.size() == 7) ? (int8_t)command.packet[5] : (int16_t)((command.packet[5] << 8) | command.packet[6]);
+	if (command.packet[0] == kXBusCmd_Set)
+		result = xbus.setCommand(command.packet[3], command.packet[4], &value);
+	else
+		result = xbus.getCommand(command.packet[3], command.packet[4], &value);
+	bus.unscript();
+
+	return (result == expected) && (bus.txLog == command.packet);
+}
+
+
+//****************************************************************************
+//	generateTrace
+//		make a trace with the simulated servos.  the servos move with sine
+//		wave and some parameters are set and read back
+//****************************************************************************
+static int generateTrace(int numOfServo, int numOfFrame, const char* fileName)
+{
+	static uint8_t	ring[1 << 20];
+	XBusRecordRing	recorder(ring, sizeof(ring));
+	XBusServoEx		xbus(-1, numOfServo);
+	SimBus			bus(numOfServo);
+	FILE*			out;
+	int				frame;
+	int				servo;
+	int				value;
+
+	out = fopen(fileName, "wb");
+	if (out == NULL)
+	{
+		perror(fileName);
+		return 3;
+	}
+
+	Serial.attach(&bus);
+	xbus.begin();
+	xbus.setTraceRecorder(&recorder);
+	for (servo = 1; servo <= numOfServo; servo++)
+		xbus.addServo(servo, kXbusServoNeutral);
+
+	for (frame = 0; frame < numOfFrame; frame++)
+	{
+		for (servo = 1; servo <= numOfServo; servo++)
+			xbus.setServo(servo, kXbusServoNeutral + (int)(8000 * sin((frame + servo * 7) * 0.05)));
+		xbus.sendChannelDataPacket();
+
+		// the servo numOfServo + 1 does not respond, to record the time out
+		if ((frame % 50) == 25)
+		{
+			value = frame & 0x7F;
+			xbus.setCommand((frame / 50) % (numOfServo + 1) + 1, kXBusOrder_1_SpeedLimit, &value);
+			xbus.getCommand((frame / 50) % (numOfServo + 1) + 1, kXBusOrder_1_SpeedLimit, &value);
+		}
+		hostAdvanceMicros(kXBusInterval * 1000L);
+
+		RecordWriter	writer(out);
+		recorder.dump(writer);
+	}
+
+	fclose(out);
+	xbus.end();
+	printf("%lu records, %lu lost\n", recorder.recordCount(), recorder.overflowCount());
+	return 0;
+}
+
+
+int main(int argc, char* argv[])
+{
+	std::vector<TraceRecord>	trace;
+	const char*		fileName = NULL;
+	int				repeat = 1;
+	unsigned long	limit = 0;
+	unsigned long	frames = 0;
+	unsigned long	commands = 0;
+	unsigned long	mismatches = 0;
+	uint64_t		nsec = 0;
+	unsigned long	time;
+	int				pass;
+	size_t			index;
+
+	for (index = 1; index < (size_t)argc; index++)
+	{
+		if ((strcmp(argv[index], "-g") == 0) && (index + 3 < (size_t)argc))
+			return generateTrace(atoi(argv[index + 1]), atoi(argv[index + 2]), argv[index + 3]);
+		else if ((strcmp(argv[index], "-r") == 0) && (index + 1 < (size_t)argc))
+			repeat = atoi(argv[++index]);
+		else if ((strcmp(argv[index], "-l") == 0) && (index + 1 < (size_t)argc))
+			limit = strtoul(argv[++index], NULL, 10);
+		else
+			fileName = argv[index];
+	}
+
+	if ((fileName == NULL) || (repeat < 1) || (! loadTrace(fileName, trace)))
+	{
+		fprintf(stderr, "usage : %s [-r repeat] [-l maxNSecPerFrame] trace.bin\n", argv[0]);
+		fprintf(stderr, "        %s -g numOfServo numOfFrame trace.bin\n", argv[0]);
+		return 3;
+	}
+
+	for (pass = 0; pass < repeat; pass++)
+	{
+		XBusServoEx		xbus(-1, kXBusMaxServoNum);
+		SimBus			bus(kXBusMaxServoNum);
+
+		Serial.attach(&bus);
+		xbus.begin();
+
+		for (index = 0; index < trace.size(); index++)
+		{
+			switch (trace[index].type)
+			{
+				case kXBusRecord_Frame:
+				case kXBusRecord_Sniff:
+					if ((! replayFrame(xbus, bus, trace[index], &nsec)) && (pass == 0))
+					{
+						fprintf(stderr, "frame at %lu is different\n", trace[index].time);
+						mismatches++;
+					}
+					frames++;
+					break;
+
+				case kXBusRecord_Command:
+					time = trace[index].time;
+					if ((! replayCommand(xbus, bus, trace, &index)) && (pass == 0))
+					{
+						fprintf(stderr, "command at %lu is different\n", time);
+						mismatches++;
+					}
+					commands++;
+					break;
+
+				default:
+					break;
+			}
+		}
+
+		xbus.end();
+		Serial.attach(NULL);
+	}
+
+	printf("%lu frames, %lu commands, %lu mismatches\n", frames / repeat, commands / repeat, mismatches);
+	if (frames > 0)
+		printf("%lu nSec per frame\n", (unsigned long)(nsec / frames));
+
+	if (mismatches > 0)
+		return 1;
+	if ((limit > 0) && (frames > 0) && (nsec / frames > limit))
+		return 2;
+	return 0;
+}
@@ -0,0 +1,131 @@
+/* xbus_sniff_decode.cpp file
+ *
+ * for host PC
+ *
+ * decoder for the records dumped by XBusSniffer::dump or the trace recorder
+ * (XBusRecordRing::dump)
+ *
+ *	build :	g++ -O2 -o xbus_sniff_decode xbus_sniff_decode.cpp
+ *	usage :	xbus_sniff_decode capture.bin
+ *			xbus_sniff_decode < capture.bin
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define	kXBusRecordHeaderSize		6
+
+#define	kXBusRecord_Sniff			0x5A
+#define	kXBusRecord_Frame			0x46
+#define	kXBusRecord_Command			0x43
+#define	kXBusRecord_Response		0x52
+#define	kXBusRecord_Error			0x45
+
+#define	kXBusCmd_Set				0x20
+#define	kXBusCmd_Get				0x21
+#define	kXBusCmd_Status				0x22
+#define	kXBusCmd_ModeA				0xa4
+
+
+//****************************************************************************
+//	printPacket
+//		return :		none
+//		parameter :	type		type of the record
+//					time		time of the packet in uSec
+//					gap			uSec from the previous packet
+//					packet		XBus packet including the CRC
+//					size		size of the packet
+//****************************************************************************
+static void printPacket(int type, unsigned long time, unsigned long gap, const uint8_t* packet, int size)
+{
+	int			index;
+
+	printf("%10lu %+8ld %c ", time, (long)gap, (type == kXBusRecord_Sniff) ? ' ' : type);
+
+	if (type == kXBusRecord_Error)
+	{
+		printf("error %d\n", packet[0]);
+		return;
+	}
+
+	switch (packet[0])
+	{
+		case kXBusCmd_ModeA:
+			printf("ModeA  %2d ch :", (size - 5) / 4);
+			for (index = 4; index + 4 < size; index += 4)
+				printf(" %d=%04X", packet[index], (packet[index + 2] << 8) | packet[index + 3]);
+			break;
+
+		case kXBusCmd_Set:
+		case kXBusCmd_Get:
+		case kXBusCmd_Status:
+			printf("%-6s ID %02X order %02X",
+					(packet[0] == kXBusCmd_Set) ? "Set" : ((packet[0] == kXBusCmd_Get) ? "Get" : "Status"),
+					packet[3], packet[4]);
+			if (size == 7)
+				printf(" value %02X", packet[5]);
+			else if (size >= 8)
+				printf(" value %04X", (packet[5] << 8) | packet[6]);
+			break;
+
+		default:
+			printf("unknown");
+			for (index = 0; index < size; index++)
+				printf(" %02X", packet[index]);
+			break;
+	}
+
+	printf("\n");
+}
+
+
+int main(int argc, char* argv[])
+{
+	FILE*			in = stdin;
+	uint8_t			header[kXBusRecordHeaderSize];
+	uint8_t			packet[256];
+	unsigned long	time;
+	unsigned long	lastTime = 0;
+	unsigned long	packets = 0;
+	unsigned long	skipped = 0;
+	int				data;
+
+	if (argc > 1)
+	{
+		in = fopen(argv[1], "rb");
+		if (in == NULL)
+		{
+			perror(argv[1]);
+			return 1;
+		}
+	}
+
+	while ((data = fgetc(in)) != EOF)
+	{
+		// resync with the record type when the capture is cut in the middle
+		if ((data != kXBusRecord_Sniff) && (data != kXBusRecord_Frame) && (data != kXBusRecord_Command)
+				&& (data != kXBusRecord_Response) && (data != kXBusRecord_Error))
+		{
+			skipped++;
+			continue;
+		}
+
+		header[0] = data;
+		if (fread(&header[1], 1, kXBusRecordHeaderSize - 1, in) != kXBusRecordHeaderSize - 1)
+			break;
+		if (fread(packet, 1, header[5], in) != header[5])
+			break;
+
+		time = (unsigned long)header[1] | ((unsigned long)header[2] << 8)
+				| ((unsigned long)header[3] << 16) | ((unsigned long)header[4] << 24);
+		printPacket(header[0], time, (packets == 0) ? 0 : (uint32_t)(time - lastTime), packet, header[5]);
+		lastTime = time;
+		packets++;
+	}
+
+	fprintf(stderr, "%lu records, %lu bytes skipped\n", packets, skipped);
+	if (in != stdin)
+		fclose(in);
+
+	return 0;
+}
@@ -0,0 +1,157 @@
+/* xbus_telemetry_decode.cpp file
+ *
+ * for host PC
+ *
+ * decoder for the telemetry log written by XBusTelemetry
+ *
+ *	build :	g++ -O2 -o xbus_telemetry_decode xbus_telemetry_decode.cpp
+ *	usage :	xbus_telemetry_decode [-b blockSize] log.bin
+ *			xbus_telemetry_decode [-b blockSize] < log.bin
+ *
+ * one line of CSV is printed for each servo in each sample :
+ *	time (uSec), channel ID, command value, current position, current power, error
+ * the position and the power are -1 until they are read.  the block with
+ * the wrong header is skipped, and the lost blocks are reported to stderr
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#define	kXBusTelemetryMagic0		'X'
+#define	kXBusTelemetryMagic1		'T'
+#define	kXBusTelemetryHeaderSize	8
+#define	kXBusTelemetryFields		4
+
+#define	kBlockNo					2
+#define	kBlockUsed					4
+#define	kBlockServoNum				6
+#define	kBlockSamples				7
+
+
+//****************************************************************************
+//	getValue
+//		return :		false if the block ends
+//		parameter :	block		the block
+//					used		bytes used in the block
+//					offset		offset of the value.  moved to the next value
+//					value		the value of the last sample.  updated
+//****************************************************************************
+static bool getValue(const uint8_t* block, unsigned int used, unsigned int* offset, int64_t* value)
+{
+	uint32_t	code = 0;
+	int			shift = 0;
+	uint8_t		data;
+
+	do
+	{
+		if ((*offset >= used) || (shift > 28))
+			return false;
+		data = block[(*offset)++];
+		code |= (uint32_t)(data & 0x7F) << shift;
+		shift += 7;
+	} while (data & 0x80);
+
+	// zigzag of 32 bits (long of AVR and ESP32)
+	*value = (int32_t)((uint32_t)*value + ((code >> 1) ^ (uint32_t)-(int32_t)(code & 1)));
+	return true;
+}
+
+
+//****************************************************************************
+//	decodeBlock
+//		return :		false if the block is broken
+//		parameter :	block		the block
+//					blockSize	size of the block
+//****************************************************************************
+static bool decodeBlock(const uint8_t* block, unsigned int blockSize)
+{
+	unsigned int	used = block[kBlockUsed] | (block[kBlockUsed + 1] << 8);
+	int				numOfServo = block[kBlockServoNum];
+	int				samples = block[kBlockSamples];
+	unsigned int	offset = kXBusTelemetryHeaderSize + numOfServo;
+	int64_t			last[1 + 256 * kXBusTelemetryFields];
+	int				sample;
+	int				servo;
+	int				field;
+
+	if ((used > blockSize) || (offset > used))
+		return false;
+
+	memset(last, 0, sizeof(last));
+	for (sample = 0; sample < samples; sample++)
+	{
+		if (! getValue(block, used, &offset, &last[0]))
+			return false;
+		for (servo = 0; servo < numOfServo; servo++)
+			for (field = 0; field < kXBusTelemetryFields; field++)
+				if (! getValue(block, used, &offset, &last[1 + servo * kXBusTelemetryFields + field]))
+					return false;
+
+		for (servo = 0; servo < numOfServo; servo++)
+		{
+			const int64_t*	value = &last[1 + servo * kXBusTelemetryFields];
+
+			printf("%lu,%d,%lld,%lld,%lld,%lld\n", (unsigned long)(uint32_t)last[0], block[kXBusTelemetryHeaderSize + servo],
+					(long long)(uint16_t)value[0], (long long)value[1], (long long)value[2], (long long)value[3]);
+		}
+	}
+
+	return true;
+}
+
+
+int main(int argc, char* argv[])
+{
+	FILE*			in = stdin;
+	unsigned int	blockSize = 512;
+	uint8_t*		block;
+	long			blockNo = -1;
+	int				arg = 1;
+
+	if ((argc > arg + 1) && (strcmp(argv[arg], "-b") == 0))
+	{
+		blockSize = atoi(argv[arg + 1]);
+		arg += 2;
+	}
+	if ((blockSize < kXBusTelemetryHeaderSize) || (argc > arg + 1))
+	{
+		fprintf(stderr, "usage : xbus_telemetry_decode [-b blockSize] [log.bin]\n");
+		return 1;
+	}
+	if (argc > arg)
+	{
+		in = fopen(argv[arg], "rb");
+		if (in == NULL)
+		{
+			perror(argv[arg]);
+			return 1;
+		}
+	}
+
+	block = (uint8_t*)malloc(blockSize);
+	printf("time,id,command,position,power,error\n");
+	while (fread(block, 1, blockSize, in) == blockSize)
+	{
+		long	number = block[kBlockNo] | (block[kBlockNo + 1] << 8);
+
+		if ((block[0] != kXBusTelemetryMagic0) || (block[1] != kXBusTelemetryMagic1))
+		{
+			fprintf(stderr, "not a telemetry block\n");
+			continue;
+		}
+		if ((blockNo >= 0) && (number != ((blockNo + 1) & 0xFFFF)))
+			fprintf(stderr, "block %ld to %ld lost\n", blockNo + 1, number - 1);
+		blockNo = number;
+
+		if (! decodeBlock(block, blockSize))
+			fprintf(stderr, "block %ld is broken\n", number);
+	}
+
+	free(block);
+	if (in != stdin)
+		fclose(in);
+
+	return 0;
+}
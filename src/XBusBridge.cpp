@@ -0,0 +1,226 @@
+/* XBusBridge.cpp file
+ *
+ * for Arduino
+ *
+ * binary pose stream from the PC to the XBus servos
+ */
+
+#include "XBusBridge.h"
+
+#define	kFrameSeq				1
+#define	kFrameServoNo			2
+#define	kFrameCount				3
+
+
+//****************************************************************************
+//	XBusBridge::XBusBridge
+//		return :		none
+//		parameter :	servo		XBusServoEx to set the poses
+//
+//		Constructor
+//		2026/10/19 : add pose bridge
+//		2026/10/19 : use XBusRxParser for the framing
+//****************************************************************************
+XBusBridge::XBusBridge(XBusServoEx& servo)
+	: parser(rxBuffer, sizeof(rxBuffer), frameRule)
+{
+	xbus = &servo;
+	port = NULL;
+	seq = 0;
+	synced = false;
+	frames = 0;
+	lost = 0;
+	rejects = 0;
+}
+
+
+//****************************************************************************
+//	XBusBridge::begin
+//		return :		none
+//		parameter :	port		serial port from the PC
+//
+//		the port should be opened by the caller.  nothing is sent to the PC
+//		2026/10/19 : add pose bridge
+//****************************************************************************
+void XBusBridge::begin(Stream& port)
+{
+	this->port = &port;
+	parser.reset();
+}
+
+
+//****************************************************************************
+//	XBusBridge::poll
+//		return :		true if one or more poses are set
+//		parameter :	none
+//
+//		feed all bytes in the RX buffer of the port.  call this in loop()
+//		2026/10/19 : add pose bridge
+//****************************************************************************
+bool XBusBridge::poll(void)
+{
+	bool	updated = false;
+	int		size;
+
+	if (port == NULL)
+		return false;
+
+	size = port->available();
+	while (size-- > 0)
+		if (feed(port->read()))
+			updated = true;
+
+	return updated;
+}
+
+
+//****************************************************************************
+//	XBusBridge::feed
+//		return :		true when a pose is set
+//		parameter :	data		received byte
+//
+//		put one byte to the parser.  the CRC is calculated while the bytes
+//		arrive, and the values are copied from the frame to the channel data
+//		packet as they are.  the frames already in the buffer after the
+//		completed one (after the resync of a broken frame) are set at once
+//		2026/10/19 : add pose bridge
+//		2026/10/19 : move the bytes only at the end of the buffer
+//		2026/10/19 : use XBusRxParser for the framing
+//		2026/10/19 : set the frames already in the buffer
+//****************************************************************************
+bool XBusBridge::feed(uint8_t data)
+{
+	bool	updated = false;
+	bool	completed;
+
+	for (completed = parser.feed(data); completed; completed = parser.next())
+		if (apply(parser.packet()))
+			updated = true;
+
+	return updated;
+}
+
+
+//****************************************************************************
+//	XBusBridge::apply
+//		return :		true when the pose is set
+//		parameter :	frame		frame completed by the parser
+//
+//		check the sequence number and set the values to the servos
+//		2026/10/19 : use XBusRxParser for the framing
+//****************************************************************************
+bool XBusBridge::apply(const uint8_t* frame)
+{
+	XBusError	result;
+
+	// sequence number.  the frames lost on the way are counted
+	if (synced)
+		lost += (uint8_t)(frame[kFrameSeq] - seq - 1);
+	seq = frame[kFrameSeq];
+	synced = true;
+	frames++;
+
+	result = xbus->setServosByIndex(frame[kFrameServoNo], frame[kFrameCount], frame + kXBusBridgeHeaderSize);
+	if (result != kXBusError_NoError)
+		rejects++;
+
+	return result == kXBusError_NoError;
+}
+
+
+//****************************************************************************
+//	XBusBridge::frameRule
+//		return :		size of the frame, or kXBusFrame_More / kXBusFrame_NoHeader /
+//						kXBusFrame_Broken
+//		parameter :	top			top of the bytes received
+//					count		number of the bytes
+//					bufferSize	not used.  the frame always fits in the buffer
+//
+//		frame rule of the pose frame for XBusRxParser.  the parser drops the
+//		broken frame by one byte, so that the sync byte in the values does
+//		not hide the next frame
+//		2026/10/19 : use XBusRxParser for the framing
+//****************************************************************************
+int XBusBridge::frameRule(const uint8_t* top, uint8_t count, uint8_t /* bufferSize */)
+{
+	if (top[0] != kXBusBridgeSync)
+		return kXBusFrame_NoHeader;
+
+	if (count < kXBusBridgeHeaderSize)
+		return kXBusFrame_More;
+
+	if ((top[kFrameCount] == 0) || (top[kFrameCount] > kXBusMaxServoNum))
+		return kXBusFrame_Broken;
+
+	return kXBusBridgeHeaderSize + top[kFrameCount] * 2 + 1;
+}
+
+
+//****************************************************************************
+//	XBusBridge::lastSeq / frameCount / lostCount / crcErrorCount / rejectCount
+//		return :		sequence number of the last frame / frames received /
+//						frames lost by the sequence number / broken frames /
+//						frames for the servos not added
+//		parameter :	none
+//
+//		2026/10/19 : add pose bridge
+//****************************************************************************
+uint8_t XBusBridge::lastSeq(void)
+{
+	return seq;
+}
+
+unsigned long XBusBridge::frameCount(void)
+{
+	return frames;
+}
+
+unsigned long XBusBridge::lostCount(void)
+{
+	return lost;
+}
+
+unsigned int XBusBridge::crcErrorCount(void)
+{
+	return parser.crcErrorCount();
+}
+
+unsigned int XBusBridge::rejectCount(void)
+{
+	return rejects;
+}
+
+
+//****************************************************************************
+//	XBusBridge::encode
+//		return :		size of the frame.  0 if count is out of range
+//		parameter :	frame		buffer for the frame.  kXBusBridgeMaxFrameSize bytes
+//					seq			sequence number
+//					servoNo		index of the first servo
+//					count		number of the servos
+//					values		values of the servos
+//
+//		make the pose frame.  this is for the sender on the PC
+//		2026/10/19 : add pose bridge
+//****************************************************************************
+uint8_t XBusBridge::encode(uint8_t* frame, uint8_t seq, uint8_t servoNo, uint8_t count, const uint16_t* values)
+{
+	uint8_t		size = kXBusBridgeHeaderSize;
+	uint8_t		index;
+
+	if ((count == 0) || (count > kXBusMaxServoNum))
+		return 0;
+
+	frame[0] = kXBusBridgeSync;
+	frame[kFrameSeq] = seq;
+	frame[kFrameServoNo] = servoNo;
+	frame[kFrameCount] = count;
+	for (index = 0; index < count; index++)
+	{
+		frame[size++] = values[index] >> 8;
+		frame[size++] = values[index];
+	}
+	frame[size] = XBusServoEx::crc8(frame, size);
+
+	return size + 1;
+}
@@ -0,0 +1,61 @@
+/* XBusBridge.h file
+ *
+ * for Arduino
+ *
+ * binary pose stream from the PC to the XBus servos
+ */
+
+#ifndef XBusBridge_h
+#define XBusBridge_h
+#include "XBusServoEx.h"
+
+// pose frame from the PC :
+//	[0]			kXBusBridgeSync
+//	[1]			sequence number.  +1 for each frame
+//	[2]			index of the first servo (the order of addServo, 0 origin)
+//	[3]			number of the servos (1 to kXBusMaxServoNum)
+//	[4] ...		value of each servo.  2 bytes in big endian
+//	[last]		crc8 of all bytes before
+// the values are set to the servos with setServosByIndex when the CRC is
+// right, so a pose goes out in the next channel data packet.
+
+#define	kXBusBridgeSync				0xB5
+#define	kXBusBridgeHeaderSize		4
+#define	kXBusBridgeMaxFrameSize		(kXBusBridgeHeaderSize + kXBusMaxServoNum * 2 + 1)
+
+
+class XBusBridge
+	{
+		public:
+			XBusBridge(XBusServoEx& servo);
+
+		public:
+			void			begin(Stream& port);
+			bool			poll(void);
+			bool			feed(uint8_t data);
+			uint8_t			lastSeq(void);
+			unsigned long	frameCount(void);
+			unsigned long	lostCount(void);
+			unsigned int	crcErrorCount(void);
+			unsigned int	rejectCount(void);
+
+			static uint8_t	encode(uint8_t* frame, uint8_t seq, uint8_t servoNo, uint8_t count, const uint16_t* values);
+
+		private:
+			XBusServoEx*	xbus;
+			Stream*			port;
+			uint8_t			rxBuffer[kXBusBridgeMaxFrameSize];
+			XBusRxParser	parser;
+			uint8_t			seq;
+			bool			synced;					// a frame has been received
+			unsigned long	frames;
+			unsigned long	lost;
+			unsigned int	rejects;				// frames out of the servos added
+
+			bool			apply(const uint8_t* frame);
+
+			static int		frameRule(const uint8_t* top, uint8_t count, uint8_t bufferSize);
+	};
+
+
+#endif	// of XBusBridge_h
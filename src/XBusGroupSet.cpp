@@ -0,0 +1,244 @@
+/* XBusGroupSet.cpp file
+ *
+ * for Arduino
+ *
+ * set one order of all servos of XBusServoEx with the commands back to back
+ */
+
+#include "XBusGroupSet.h"
+
+
+//****************************************************************************
+//	XBusGroupSet::XBusGroupSet
+//		return :		none
+//		parameter :	servo			XBusServoEx of the servos
+//
+//		Constructor
+//		2026/10/19 : add group set
+//****************************************************************************
+XBusGroupSet::XBusGroupSet(XBusServoEx& servo)
+{
+	xbus = &servo;
+	order = 0;
+	value = 0;
+	maxPasses = kXBusGroupPasses;
+	pass = 0;
+	numOfServo = 0;
+	servoNo = 0;
+	acks = 0;
+	memset(ackBitmap, 0, sizeof(ackBitmap));
+	timeOut = kXBusGroupTimeOut;
+	startTime = 0;
+	elapsed = 0;
+	result = kXBusError_NoError;
+	running = 0;
+	busy = 0;
+}
+
+
+//****************************************************************************
+//	XBusGroupSet::start
+//		return :		error code
+//		parameter :	order			the order that you want to set up
+//					value			the value that you want to set
+//					timeOutUSec		timeout of each servo.  0 for kXBusGroupTimeOut.
+//									it is given to each command, and the command
+//									timeout of XBusServoEx is not changed
+//					passes			number of passes.  the servos which did not ack
+//									are set again in the next pass.  0 for kXBusGroupPasses
+//
+//		start to set the order of all servos.  call update() until it
+//		returns other than kXBusError_Pending.  it does not block
+//		2026/10/19 : add group set
+//		2026/10/19 : give the timeout to each command
+//****************************************************************************
+XBusError XBusGroupSet::start(char order, int value, unsigned long timeOutUSec, unsigned char passes)
+{
+	if (running)
+		return kXBusError_BusBusy;
+
+	numOfServo = xbus->getNumOfServo();
+	if (numOfServo <= 0)
+		return kXBusError_ServoNumIsZero;
+
+	if (timeOutUSec == 0)
+		timeOutUSec = kXBusGroupTimeOut;
+	if (passes == 0)
+		passes = kXBusGroupPasses;
+
+	this->order = order;
+	this->value = value;
+	maxPasses = passes;
+	pass = 0;
+	servoNo = 0;
+	acks = 0;
+	memset(ackBitmap, 0, sizeof(ackBitmap));
+	result = kXBusError_Pending;
+	busy = 0;
+	running = 1;
+
+	timeOut = timeOutUSec;
+	startTime = micros();
+	elapsed = 0;
+
+	return kXBusError_NoError;
+}
+
+
+//****************************************************************************
+//	XBusGroupSet::update
+//		return :		kXBusError_Pending while running.  kXBusError_NoError if
+//						all servos ack, or the last error of the servos which do not
+//		parameter :	none
+//
+//		call this in loop().  it does not block.  when the response comes,
+//		the command to the next servo is sent in the same call, so the
+//		commands go back to back on the bus.  the command is not sent while
+//		the other command is waiting the response or the admission control
+//		rejects it, and it is tried again in the next call
+//		2026/10/19 : add group set
+//****************************************************************************
+XBusError XBusGroupSet::update(void)
+{
+	XBusError		error;
+	int				response;
+	char			channelID;
+
+	if (! running)
+		return result;
+
+	while (1)
+	{
+		if (busy)
+		{
+			error = xbus->pollCommand(&response);
+			if (error == kXBusError_Pending)
+				return kXBusError_Pending;
+
+			busy = 0;
+			if (error == kXBusError_NoError)
+			{
+				ackBitmap[servoNo >> 3] |= 1 << (servoNo & 7);
+				acks++;
+			}
+			else
+				result = error;
+			servoNo++;
+		}
+
+		// the next servo which does not ack yet
+		while ((servoNo < numOfServo) && isAcked(servoNo))
+			servoNo++;
+
+		if (servoNo >= numOfServo)
+		{
+			pass++;
+			if ((acks >= numOfServo) || (pass >= maxPasses))
+				return finish((acks >= numOfServo) ? kXBusError_NoError : result);
+			servoNo = 0;
+			continue;
+		}
+
+		channelID = xbus->getServoID(servoNo);
+		if (channelID == 0)
+			return finish(kXBusError_IDNotFound);					// the servo is removed
+
+		error = xbus->startSetCommand(channelID, order, value, timeOut);
+		if (error == kXBusError_BusBusy)
+			return kXBusError_Pending;
+		if (error != kXBusError_NoError)
+			return finish(error);
+		busy = 1;
+	}
+}
+
+
+//****************************************************************************
+//	XBusGroupSet::run
+//		return :		error code.  same as update()
+//		parameter :	same as start()
+//
+//		set the order of all servos and wait for the end
+//		2026/10/19 : add group set
+//****************************************************************************
+XBusError XBusGroupSet::run(char order, int value, unsigned long timeOutUSec, unsigned char passes)
+{
+	XBusError		error;
+
+	error = start(order, value, timeOutUSec, passes);
+	if (error != kXBusError_NoError)
+		return error;
+
+	while ((error = update()) == kXBusError_Pending)
+		yield();
+
+	return error;
+}
+
+
+//****************************************************************************
+//	XBusGroupSet::isRunning / isAcked / getAckBitmap / ackCount / failCount /
+//	getElapsedTime
+//		return :		true while running / true if the servo acks /
+//						ack bitmap (bit n of byte n / 8 for servo n) /
+//						servos which ack / servos which do not ack /
+//						uSec from start() to the end (or to now while running)
+//		parameter :	servoNo		index of the servo in the order it was added
+//
+//		the results of the last start()
+//		2026/10/19 : add group set
+//****************************************************************************
+bool XBusGroupSet::isRunning(void)
+{
+	return running != 0;
+}
+
+bool XBusGroupSet::isAcked(int servoNo)
+{
+	if ((servoNo < 0) || (servoNo >= numOfServo))
+		return false;
+
+	return (ackBitmap[servoNo >> 3] & (1 << (servoNo & 7))) != 0;
+}
+
+const uint8_t* XBusGroupSet::getAckBitmap(void)
+{
+	return ackBitmap;
+}
+
+int XBusGroupSet::ackCount(void)
+{
+	return acks;
+}
+
+int XBusGroupSet::failCount(void)
+{
+	return numOfServo - acks;
+}
+
+unsigned long XBusGroupSet::getElapsedTime(void)
+{
+	if (running)
+		return micros() - startTime;
+
+	return elapsed;
+}
+
+
+//****************************************************************************
+//	XBusGroupSet::finish
+//		return :		error
+//		parameter :	error		result of the group set
+//
+//		keep the result and the elapsed time
+//		2026/10/19 : add group set
+//		2026/10/19 : the command timeout of XBusServoEx is not changed
+//****************************************************************************
+XBusError XBusGroupSet::finish(XBusError error)
+{
+	elapsed = micros() - startTime;
+	result = error;
+	running = 0;
+
+	return error;
+}
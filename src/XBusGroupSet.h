@@ -0,0 +1,55 @@
+/* XBusGroupSet.h file
+ *
+ * for Arduino
+ *
+ * set one order of all servos of XBusServoEx with the commands back to back
+ */
+
+#ifndef XBusGroupSet_h
+#define XBusGroupSet_h
+#include "XBusServoEx.h"
+
+#define	kXBusGroupTimeOut			5000			// uSec.  default timeout of each servo
+#define	kXBusGroupPasses			2				// default passes.  the second pass sends again to the servos failed
+#define	kXBusGroupBitmapSize		((kXBusMaxServoNum + 7) / 8)
+
+
+class XBusGroupSet
+	{
+		public:
+			XBusGroupSet(XBusServoEx& servo);
+
+		public:
+			XBusError		start(char order, int value, unsigned long timeOutUSec, unsigned char passes);
+			XBusError		update(void);
+			XBusError		run(char order, int value, unsigned long timeOutUSec, unsigned char passes);
+			bool			isRunning(void);
+
+			bool			isAcked(int servoNo);
+			const uint8_t*	getAckBitmap(void);
+			int				ackCount(void);
+			int				failCount(void);
+			unsigned long	getElapsedTime(void);
+
+		private:
+			XBusServoEx*	xbus;
+			char			order;
+			int				value;
+			unsigned char	maxPasses;
+			unsigned char	pass;
+			int				numOfServo;					// servos when it is started
+			int				servoNo;					// servo being set
+			int				acks;
+			uint8_t			ackBitmap[kXBusGroupBitmapSize];	// bit n is 1 when the servo n (in the order of addServo) acks
+			unsigned long	timeOut;					// uSec.  timeout of each command
+			unsigned long	startTime;					// micros() at start()
+			unsigned long	elapsed;					// uSec from start() to the end
+			XBusError		result;
+			char			running;
+			char			busy;						// 1 while waiting the response
+
+			XBusError		finish(XBusError error);
+	};
+
+
+#endif	// of XBusGroupSet_h
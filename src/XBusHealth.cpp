@@ -0,0 +1,260 @@
+/* XBusHealth.cpp file
+ *
+ * for Arduino
+ *
+ * servo health monitor for XBusServoEx
+ */
+
+#include "XBusHealth.h"
+
+
+//****************************************************************************
+//	XBusHealthMonitor::XBusHealthMonitor
+//		return :		none
+//		parameter :	servo			XBusServoEx to monitor
+//					maxServoNum		same as the one given to XBusServoEx
+//
+//		Constructor
+//		2026/10/19 : add health monitor
+//****************************************************************************
+XBusHealthMonitor::XBusHealthMonitor(XBusServoEx& servo, unsigned int maxServoNum)
+{
+	xbus = &servo;
+	maxServo = maxServoNum;
+	if (maxServo > kXBusMaxServoNum)
+		maxServo = kXBusMaxServoNum;
+	health = NULL;
+	interval = 0;
+	lastTime = 0;
+	servoNo = 0;
+	order = kXBusOrder_1_AlarmLevel;
+	busy = 0;
+}
+
+
+//****************************************************************************
+//	XBusHealthMonitor::begin
+//		return :		error code
+//		parameter :	intervalMSec	mSec between the commands to read the servos.
+//									each servo is read once in
+//									(number of servos x intervalMSec)
+//
+//		start the servo statistics of XBusServoEx and allocate the buffer.
+//		call this after begin() of XBusServoEx.  the servos must have the
+//		direction pin (not TX only mode) to return the values
+//		2026/10/19 : add health monitor
+//****************************************************************************
+XBusError XBusHealthMonitor::begin(unsigned long intervalMSec)
+{
+	XBusError		result;
+	unsigned int	index;
+
+	result = xbus->enableServoStats();
+	if (result != kXBusError_NoError)
+		return result;
+
+	if (health == NULL)
+	{
+		health = (XBusServoHealth*)malloc(maxServo * sizeof(XBusServoHealth));
+		if (health == NULL)
+			return kXBusError_MemoryFull;
+	}
+
+	for (index = 0; index < maxServo; index++)
+	{
+		health[index].power = kXBusHealthUnknown;
+		health[index].alarmLevel = kXBusHealthUnknown;
+		health[index].powerTime = 0;
+	}
+
+	interval = intervalMSec;
+	lastTime = millis() - interval;
+	servoNo = 0;
+	busy = 0;
+
+	return kXBusError_NoError;
+}
+
+
+//****************************************************************************
+//	XBusHealthMonitor::end
+//		return :		none
+//		parameter :	none
+//
+//		2026/10/19 : add health monitor
+//****************************************************************************
+void XBusHealthMonitor::end(void)
+{
+	int			value;
+
+	// wait the command in progress not to leave the bus in Rx
+	while (busy && (xbus->pollCommand(&value) == kXBusError_Pending))
+		;
+	busy = 0;
+
+	if (health != NULL)
+		free(health);
+	health = NULL;
+}
+
+
+//****************************************************************************
+//	XBusHealthMonitor::update
+//		return :		none
+//		parameter :	none
+//
+//		call this in loop().  it does not block.  it reads the alarm level of
+//		each servo once, then the current power of the servos one by one.
+//		the command of the sketch returns kXBusError_BusBusy while this waits
+//		the response.  the command has its own short timeout
+//		(kXBusHealthTimeOut) whatever setCommandTimeOut is
+//		2026/10/19 : add health monitor
+//		2026/10/19 : give the timeout to each command
+//****************************************************************************
+void XBusHealthMonitor::update(void)
+{
+	XBusError		result;
+	int				value;
+	char			channelID;
+
+	if (health == NULL)
+		return;
+
+	if (busy)
+	{
+		result = xbus->pollCommand(&value);
+		if (result == kXBusError_Pending)
+			return;
+
+		busy = 0;
+		if ((result == kXBusError_NoError) && (servoNo < xbus->getNumOfServo()))
+		{
+			if (order == kXBusOrder_1_AlarmLevel)
+				health[servoNo].alarmLevel = value & 0xFF;
+			else
+			{
+				health[servoNo].power = value & 0xFF;
+				health[servoNo].powerTime = millis();
+			}
+		}
+		else if ((result == kXBusError_Unsupported) && (order == kXBusOrder_1_AlarmLevel))
+			health[servoNo].alarmLevel = 0;						// no alarm
+		next();
+		return;
+	}
+
+	if ((millis() - lastTime) < interval)
+		return;
+
+	if (servoNo >= xbus->getNumOfServo())
+		servoNo = 0;
+	channelID = xbus->getServoID(servoNo);
+	if (channelID == 0)
+		return;
+
+	order = (health[servoNo].alarmLevel == kXBusHealthUnknown) ? kXBusOrder_1_AlarmLevel : kXBusOrder_1_CurrentPow;
+	if (xbus->startGetCommand(channelID, order, kXBusHealthTimeOut) == kXBusError_NoError)
+	{
+		busy = 1;
+		lastTime = millis();
+	}
+}
+
+
+//****************************************************************************
+//	XBusHealthMonitor::getHealth
+//		return :		error code
+//		parameter :	channelID	channel ID of the XBus servo
+//					health		buffer to get the values
+//
+//		2026/10/19 : add health monitor
+//****************************************************************************
+XBusError XBusHealthMonitor::getHealth(char channelID, XBusServoHealth* health)
+{
+	int			index;
+
+	if (this->health == NULL)
+		return kXBusError_Unsupported;
+
+	for (index = 0; index < xbus->getNumOfServo(); index++)
+		if (xbus->getServoID(index) == (channelID & 0x3F))
+		{
+			*health = this->health[index];
+			return kXBusError_NoError;
+		}
+
+	return kXBusError_IDNotFound;
+}
+
+
+//****************************************************************************
+//	XBusHealthMonitor::printHealth
+//		return :		bytes written
+//		parameter :	out			destination like Serial
+//
+//		write one line for each servo.  the values are separated by a space
+//			ID commands CRCErrors timeouts echoErrors retries power alarmLevel
+//			latency histogram (kXBusLatencyBins values. <1mSec, <2mSec, <4mSec ...)
+//		"!" is added when the power is over the alarm level
+//		2026/10/19 : add health monitor
+//****************************************************************************
+size_t XBusHealthMonitor::printHealth(Print& out)
+{
+	XBusServoStats	stats;
+	size_t			written = 0;
+	int				index;
+	int				bin;
+	char			channelID;
+
+	if (health == NULL)
+		return 0;
+
+	for (index = 0; index < xbus->getNumOfServo(); index++)
+	{
+		channelID = xbus->getServoID(index);
+		if (xbus->getServoStats(channelID, &stats) != kXBusError_NoError)
+			continue;
+
+		written += out.print((int)channelID);
+		written += out.print(' ');
+		written += out.print(stats.commands);
+		written += out.print(' ');
+		written += out.print(stats.crcErrors);
+		written += out.print(' ');
+		written += out.print(stats.timeouts);
+		written += out.print(' ');
+		written += out.print(stats.echoErrors);
+		written += out.print(' ');
+		written += out.print(stats.retries);
+		written += out.print(' ');
+		written += out.print(health[index].power);
+		written += out.print(' ');
+		written += out.print(health[index].alarmLevel);
+		for (bin = 0; bin < kXBusLatencyBins; bin++)
+		{
+			written += out.print(' ');
+			written += out.print(stats.latency[bin]);
+		}
+		if ((health[index].power != kXBusHealthUnknown) && (health[index].alarmLevel > 0)
+				&& (health[index].power >= health[index].alarmLevel))
+			written += out.print(" !");
+		written += out.println();
+	}
+
+	return written;
+}
+
+
+//****************************************************************************
+//	XBusHealthMonitor::next
+//		return :		none
+//		parameter :	none
+//
+//		2026/10/19 : add health monitor
+//****************************************************************************
+void XBusHealthMonitor::next(void)
+{
+	servoNo++;
+	if (servoNo >= xbus->getNumOfServo())
+		servoNo = 0;
+}
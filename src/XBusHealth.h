@@ -0,0 +1,50 @@
+/* XBusHealth.h file
+ *
+ * for Arduino
+ *
+ * servo health monitor for XBusServoEx
+ */
+
+#ifndef XBusHealth_h
+#define XBusHealth_h
+#include "XBusServoEx.h"
+
+#define	kXBusHealthUnknown			-1				// the value is not read yet
+#define	kXBusHealthTimeOut			5000			// uSec.  timeout of the command.  the frames are stopped until then
+
+
+typedef struct
+{
+	int					power;						// last kXBusOrder_1_CurrentPow
+	int					alarmLevel;					// kXBusOrder_1_AlarmLevel
+	unsigned long		powerTime;					// millis() when power is read
+} XBusServoHealth;
+
+
+class XBusHealthMonitor
+	{
+		public:
+			XBusHealthMonitor(XBusServoEx& servo, unsigned int maxServoNum);
+
+		public:
+			XBusError		begin(unsigned long intervalMSec);
+			void			end(void);
+			void			update(void);
+			XBusError		getHealth(char channelID, XBusServoHealth* health);
+			size_t			printHealth(Print& out);
+
+		private:
+			XBusServoEx*	xbus;
+			unsigned int	maxServo;
+			XBusServoHealth*	health;					// for each servo in the order it was added
+			unsigned long	interval;					// mSec between the commands
+			unsigned long	lastTime;					// millis() at the last command
+			int				servoNo;					// servo being read
+			char			order;						// order being read
+			char			busy;						// 1 while waiting the response
+
+			void			next(void);
+	};
+
+
+#endif	// of XBusHealth_h
@@ -0,0 +1,265 @@
+/* XBusMotion.cpp file
+ *
+ * for Arduino
+ *
+ * keyframe motion player for XBusServoEx
+ */
+
+#include "XBusMotion.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include "esp_partition.h"
+#include "esp_idf_version.h"
+#endif
+
+
+//****************************************************************************
+// read 2 bytes little endian value from flash.
+// read by byte so that it works also on odd address
+static inline uint16_t readMotionWord(const uint8_t* p)
+{
+	return (uint16_t)pgm_read_byte(p) | ((uint16_t)pgm_read_byte(p + 1) << 8);
+}
+
+
+//****************************************************************************
+//	XBusMotionPlayer::XBusMotionPlayer
+//		return :		none
+//		parameter :	servo		XBusServoEx to drive
+//
+//		Constructor
+//		2026/10/19 : add motion player
+//****************************************************************************
+XBusMotionPlayer::XBusMotionPlayer(XBusServoEx& servo)
+{
+	xbus = &servo;
+	motionData = NULL;
+	keyframe = NULL;
+	numOfKeyframe = 0;
+	keyframeNo = 0;
+	numOfChannel = 0;
+	loop = false;
+	playing = false;
+	frameNo = 0;
+	duration = 1;
+	timeScale = 0;
+}
+
+
+//****************************************************************************
+//	XBusMotionPlayer::play
+//		return :		error code
+//		parameter :	motion		motion data in PROGMEM (or memory mapped flash on ESP32)
+//					repeat		true to play it again from the first keyframe
+//
+//		start to play the motion.  the first keyframe is set immediately.
+//		make the last pose same as the first one for seamless repeat.
+//		2026/10/19 : add motion player
+//****************************************************************************
+XBusError XBusMotionPlayer::play(const uint8_t* motion, bool repeat)
+{
+	int			channelNo;
+
+	playing = false;
+	if (motion == NULL)
+		return kXBusError_Unsupported;
+
+	// check header
+	if ((pgm_read_byte(motion) != 'X') || (pgm_read_byte(motion + 1) != 'M')
+			|| (pgm_read_byte(motion + 2) != kXBusMotionVersion))
+		return kXBusError_Unsupported;
+	numOfChannel = pgm_read_byte(motion + 3);
+	numOfKeyframe = readMotionWord(motion + 4);
+	if (numOfChannel > kXBusMotionMaxChannels)
+		return kXBusError_ServoNumOverflow;
+	if ((numOfChannel == 0) || (numOfKeyframe == 0))
+		return kXBusError_ServoNumIsZero;
+
+	motionData = motion;
+	loop = repeat;
+
+	// set the first pose
+	keyframe = motionData + kXBusMotionHeaderSize;
+	for (channelNo = 0; channelNo < numOfChannel; channelNo++)
+	{
+		fromValue[channelNo] = readMotionWord(keyframe + 2 + 2 * channelNo);
+		xbus->setServoByIndex(channelNo, fromValue[channelNo]);
+	}
+
+	keyframe += 2 + 2 * numOfChannel;
+	keyframeNo = 1;
+	playing = true;
+	startKeyframe();
+
+	return kXBusError_NoError;
+}
+
+
+//****************************************************************************
+//	XBusMotionPlayer::stop
+//		return :		none
+//		parameter :	none
+//
+//		stop the motion.  servos stay at the current value
+//		2026/10/19 : add motion player
+//****************************************************************************
+void XBusMotionPlayer::stop(void)
+{
+	playing = false;
+}
+
+
+//****************************************************************************
+//	XBusMotionPlayer::isPlaying
+//		return :		true while playing
+//		parameter :	none
+//
+//		2026/10/19 : add motion player
+//****************************************************************************
+bool XBusMotionPlayer::isPlaying(void)
+{
+	return playing;
+}
+
+
+//****************************************************************************
+//	XBusMotionPlayer::update
+//		return :		none
+//		parameter :	none
+//
+//		This should be called once per frame just before sendChannelDataPacket
+//		on the timer handler.  it reads the deltas of the current keyframe from
+//		flash and puts the interpolated values to the channel packet.
+//		no division and no heap, so the cost per frame is constant.
+//		2026/10/19 : add motion player
+//****************************************************************************
+void XBusMotionPlayer::update(void)
+{
+	const uint8_t*	delta;
+	uint32_t		t;
+	int				channelNo;
+
+	if (! playing)
+		return;
+
+	frameNo++;
+	if (frameNo >= duration)
+	{
+		finishKeyframe();
+		return;
+	}
+
+	// t = frameNo / duration in 1/65536 unit.  always less than 65536
+	t = frameNo * timeScale;
+	delta = keyframe + 2;
+	for (channelNo = 0; channelNo < numOfChannel; channelNo++, delta += 2)
+	{
+		int32_t		move;
+
+		move = ((int32_t)(int16_t)readMotionWord(delta) * (int32_t)t) >> (16 - kXBusMotionDeltaShift);
+		xbus->setServoByIndex(channelNo, (uint16_t)(fromValue[channelNo] + move));
+	}
+}
+
+
+//****************************************************************************
+//	XBusMotionPlayer::startKeyframe
+//		return :		none
+//		parameter :	none
+//
+//		prepare the keyframe that keyframe points
+//		2026/10/19 : add motion player
+//****************************************************************************
+void XBusMotionPlayer::startKeyframe(void)
+{
+	int			channelNo;
+
+	if (keyframeNo >= numOfKeyframe)
+	{
+		if (! loop)
+		{
+			playing = false;
+			return;
+		}
+
+		// back to the first pose
+		keyframe = motionData + kXBusMotionHeaderSize;
+		for (channelNo = 0; channelNo < numOfChannel; channelNo++)
+			fromValue[channelNo] = readMotionWord(keyframe + 2 + 2 * channelNo);
+		keyframe += 2 + 2 * numOfChannel;
+		keyframeNo = 1;
+		if (numOfKeyframe == 1)
+		{
+			playing = false;
+			return;
+		}
+	}
+
+	duration = readMotionWord(keyframe);
+	if (duration == 0)
+		duration = 1;
+	timeScale = 65536UL / duration;
+	frameNo = 0;
+}
+
+
+//****************************************************************************
+//	XBusMotionPlayer::finishKeyframe
+//		return :		none
+//		parameter :	none
+//
+//		set the pose of the current keyframe exactly and go to the next one
+//		2026/10/19 : add motion player
+//****************************************************************************
+void XBusMotionPlayer::finishKeyframe(void)
+{
+	const uint8_t*	delta;
+	int				channelNo;
+
+	delta = keyframe + 2;
+	for (channelNo = 0; channelNo < numOfChannel; channelNo++, delta += 2)
+	{
+		fromValue[channelNo] += (uint16_t)((int16_t)readMotionWord(delta) << kXBusMotionDeltaShift);
+		xbus->setServoByIndex(channelNo, fromValue[channelNo]);
+	}
+
+	keyframe = delta;
+	keyframeNo++;
+	startKeyframe();
+}
+
+
+#if defined(ARDUINO_ARCH_ESP32)
+
+//****************************************************************************
+//	XBusMotionPlayer::mapPartition
+//		return :		top of the mapped partition.  NULL if not found
+//		parameter :	label		label of the data partition that has the motion
+//
+//		map the data partition to the address space so that play() can read
+//		the motion from flash directly.  the mapping is kept until reset
+//		2026/10/19 : add motion player
+//****************************************************************************
+const uint8_t* XBusMotionPlayer::mapPartition(const char* label)
+{
+	const esp_partition_t*	partition;
+	const void*				mappedData;
+
+	partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+	if (partition == NULL)
+		return NULL;
+
+#if ESP_IDF_VERSION_MAJOR >= 5
+	esp_partition_mmap_handle_t		handle;
+	if (esp_partition_mmap(partition, 0, partition->size, ESP_PARTITION_MMAP_DATA, &mappedData, &handle) != ESP_OK)
+		return NULL;
+#else
+	spi_flash_mmap_handle_t			handle;
+	if (esp_partition_mmap(partition, 0, partition->size, SPI_FLASH_MMAP_DATA, &mappedData, &handle) != ESP_OK)
+		return NULL;
+#endif
+
+	return (const uint8_t*)mappedData;
+}
+
+#endif
@@ -0,0 +1,74 @@
+/* XBusMotion.h file
+ *
+ * for Arduino
+ *
+ * keyframe motion player for XBusServoEx
+ */
+
+#ifndef XBusMotion_h
+#define XBusMotion_h
+#include "XBusServoEx.h"
+
+#define	kXBusMotionMaxChannels		kXBusMaxServoNum
+#define	kXBusMotionVersion			1
+
+// motion data format (all multi byte values are little endian)
+//
+//	header (6 bytes)
+//		'X' 'M'				magic
+//		version				kXBusMotionVersion
+//		numOfChannel		number of channels in each keyframe (1 to kXBusMotionMaxChannels)
+//		numOfKeyframe		2 bytes
+//
+//	keyframe (2 + 2 * numOfChannel bytes) x numOfKeyframe
+//		duration			2 bytes. number of frames (kXBusInterval) to reach this pose
+//		value or delta		2 bytes for each channel
+//							first keyframe : absolute raw value (unsigned)
+//							other keyframe : signed delta from the previous pose
+//											 in units of 2 raw counts.  use XBUS_MOTION_DELTA
+//											 so that the rounding does not accumulate
+//
+// channel n of the motion drives the n-th servo added with addServo.
+#define	kXBusMotionHeaderSize		6
+#define	kXBusMotionDeltaShift		1
+
+#define	XBUS_MOTION_U16(v)			((uint8_t)((v) & 0xFF)), ((uint8_t)(((v) >> 8) & 0xFF))
+#define	XBUS_MOTION_HEADER(ch, kf)	'X', 'M', kXBusMotionVersion, (ch), XBUS_MOTION_U16(kf)
+#define	XBUS_MOTION_DELTA(from, to)	XBUS_MOTION_U16((int16_t)(((long)(to) >> kXBusMotionDeltaShift) - ((long)(from) >> kXBusMotionDeltaShift)))
+
+
+class XBusMotionPlayer
+	{
+		public:
+			XBusMotionPlayer(XBusServoEx& servo);
+
+		public:
+			XBusError		play(const uint8_t* motion, bool repeat);
+			void			stop(void);
+			bool			isPlaying(void);
+			void			update(void);
+
+#if defined(ARDUINO_ARCH_ESP32)
+			static const uint8_t*	mapPartition(const char* label);
+#endif
+
+		private:
+			XBusServoEx*	xbus;
+			const uint8_t*	motionData;					// top of the motion data in flash
+			const uint8_t*	keyframe;					// current keyframe in flash
+			uint16_t		numOfKeyframe;
+			uint16_t		keyframeNo;
+			uint8_t			numOfChannel;
+			bool			loop;
+			bool			playing;
+			uint16_t		frameNo;					// frame count in the current keyframe
+			uint16_t		duration;					// frames of the current keyframe
+			uint32_t		timeScale;					// 65536 / duration
+			uint16_t		fromValue[kXBusMotionMaxChannels];	// pose of the previous keyframe
+
+			void			startKeyframe(void);
+			void			finishKeyframe(void);
+	};
+
+
+#endif	// of XBusMotion_h
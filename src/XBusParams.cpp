@@ -0,0 +1,395 @@
+/* XBusParams.cpp file
+ *
+ * for Arduino
+ *
+ * snapshot, diff and restore of the servo parameters for XBusServoEx
+ */
+
+#include "XBusParams.h"
+
+
+// parameters in the snapshot.  the order of this table is the order in the blob,
+// so change kXBusParamVersion when it is changed
+typedef struct
+{
+	char			order;
+	uint8_t			paramIndex;						// XBusParamIdx for kXBusOrder_2_ParamWrite
+	uint8_t			size;							// bytes of the value
+} XBusParamDesc;
+
+// the index and the size come from the order descriptor table
+#define	XBusParam(order)		{order, XBusOrderDesc<order>::paramIndex, XBusOrderDesc<order>::size}
+
+static const XBusParamDesc	paramTable[kXBusParamNum] = {
+	XBusParam(kXBusOrder_2_Reverse),
+	XBusParam(kXBusOrder_2_Neutral),
+	XBusParam(kXBusOrder_2_H_Travel),
+	XBusParam(kXBusOrder_2_L_Travel),
+	XBusParam(kXBusOrder_2_H_Limit),
+	XBusParam(kXBusOrder_2_L_Limit),
+	XBusParam(kXBusOrder_1_P_Gain),
+	XBusParam(kXBusOrder_1_I_Gain),
+	XBusParam(kXBusOrder_1_D_Gain),
+	XBusParam(kXBusOrder_1_DeadBand),
+	XBusParam(kXBusOrder_2_PowerOffset),
+	XBusParam(kXBusOrder_1_AlarmLevel),
+	XBusParam(kXBusOrder_2_AlarmDelay),
+	XBusParam(kXBusOrder_1_Angle_180),
+	XBusParam(kXBusOrder_1_SlowStart),
+	XBusParam(kXBusOrder_1_StopMode),
+	XBusParam(kXBusOrder_1_SpeedLimit),
+	XBusParam(kXBusOrder_2_MaxInteger),
+	};
+
+#define	kRecordID				0
+#define	kRecordMask				1
+#define	kRecordValue			5
+
+
+//****************************************************************************
+//	blobCRC
+//		return :		crc8 of the bytes
+//		parameter :	blob		the bytes
+//					size		number of the bytes
+//
+//		XBusServoEx::crc8 is only for 255 bytes
+//		2026/10/19 : add parameter snapshot
+//****************************************************************************
+static uint8_t blobCRC(const uint8_t* blob, unsigned int size)
+{
+	uint8_t		crc = 0;
+
+	while (size-- > 0)
+		crc = XBusServoEx::crc_table(*blob++, crc);
+
+	return crc;
+}
+
+
+//****************************************************************************
+//	XBusParamSnapshot::XBusParamSnapshot
+//		return :		none
+//		parameter :	servo		XBusServoEx of the servos
+//
+//		Constructor
+//		2026/10/19 : add parameter snapshot
+//****************************************************************************
+XBusParamSnapshot::XBusParamSnapshot(XBusServoEx& servo)
+{
+	xbus = &servo;
+}
+
+
+//****************************************************************************
+//	XBusParamSnapshot::snapshot
+//		return :		error code
+//		parameter :	blob		buffer of XBusParamBlobSize(number of servos) bytes
+//					size		size of the buffer
+//
+//		read all parameters of the servos added to XBusServoEx.  the
+//		parameter which the servo does not support is not in the mask.
+//		it blocks until all parameters are read
+//		2026/10/19 : add parameter snapshot
+//****************************************************************************
+XBusError XBusParamSnapshot::snapshot(uint8_t* blob, unsigned int size)
+{
+	XBusError		result;
+	int				numOfServo = xbus->getNumOfServo();
+	int				servoNo;
+	unsigned int	blobSize;
+
+	blobSize = XBusParamBlobSize(numOfServo);
+	if (size < blobSize)
+		return kXBusError_MemoryFull;
+
+	blob[0] = kXBusParamMagic0;
+	blob[1] = kXBusParamMagic1;
+	blob[2] = kXBusParamVersion;
+	blob[3] = numOfServo;
+	blob[4] = kXBusParamNum;
+
+	for (servoNo = 0; servoNo < numOfServo; servoNo++)
+	{
+		result = readServo(xbus->getServoID(servoNo), &blob[kXBusParamHeaderSize + servoNo * kXBusParamServoSize]);
+		if (result != kXBusError_NoError)
+			return result;
+	}
+
+	blob[blobSize - 1] = blobCRC(blob, blobSize - 1);
+
+	return kXBusError_NoError;
+}
+
+
+//****************************************************************************
+//	XBusParamSnapshot::check
+//		return :		error code
+//		parameter :	blob		the blob read from EEPROM or flash
+//					size		bytes read
+//
+//		check the magic, the version and the CRC.  call this before diff()
+//		and restore() for the blob read from the storage
+//		2026/10/19 : add parameter snapshot
+//****************************************************************************
+XBusError XBusParamSnapshot::check(const uint8_t* blob, unsigned int size)
+{
+	unsigned int	blobSize;
+
+	if (size < XBusParamBlobSize(0))
+		return kXBusError_Unsupported;
+	if ((blob[0] != kXBusParamMagic0) || (blob[1] != kXBusParamMagic1)
+			|| (blob[2] != kXBusParamVersion) || (blob[4] != kXBusParamNum))
+		return kXBusError_Unsupported;
+
+	blobSize = XBusParamBlobSize(blob[3]);
+	if (size < blobSize)
+		return kXBusError_Unsupported;
+	if (blob[blobSize - 1] != blobCRC(blob, blobSize - 1))
+		return kXBusError_CRCError;
+
+	return kXBusError_NoError;
+}
+
+
+//****************************************************************************
+//	XBusParamSnapshot::diff
+//		return :		error code
+//		parameter :	blob		the blob checked by check()
+//					channelID	channel ID of the servo
+//					diffMask	the parameters different from the blob.
+//								bit i for the parameter i (see getParamOrder())
+//
+//		read the parameters of the servo on the bus and compare with the blob
+//		2026/10/19 : add parameter snapshot
+//****************************************************************************
+XBusError XBusParamSnapshot::diff(const uint8_t* blob, char channelID, unsigned long* diffMask)
+{
+	const uint8_t*	record;
+
+	record = findServo(blob, channelID);
+	if (record == NULL)
+		return kXBusError_IDNotFound;
+
+	return diffServo(record, diffMask);
+}
+
+
+//****************************************************************************
+//	XBusParamSnapshot::restore
+//		return :		error code
+//		parameter :	blob		the blob checked by check()
+//					channelID	channel ID of the servo
+//					numOfFields	number of the parameters restored
+//
+//		set only the parameters different from the blob, and write each of
+//		them with kXBusOrder_2_ParamWrite of its index, so the other
+//		parameters in the servo are not written.  the servo must have the
+//		channel ID in the blob (set it by setChannelID() first)
+//		2026/10/19 : add parameter snapshot
+//****************************************************************************
+XBusError XBusParamSnapshot::restore(const uint8_t* blob, char channelID, int* numOfFields)
+{
+	const uint8_t*	record;
+	const uint8_t*	data;
+	unsigned long	diffMask;
+	XBusError		result;
+	int				paramNo;
+	int				value;
+
+	*numOfFields = 0;
+	record = findServo(blob, channelID);
+	if (record == NULL)
+		return kXBusError_IDNotFound;
+
+	result = diffServo(record, &diffMask);
+	if (result != kXBusError_NoError)
+		return result;
+
+	data = &record[kRecordValue];
+	for (paramNo = 0; paramNo < kXBusParamNum; data += paramTable[paramNo].size, paramNo++)
+	{
+		if (! (diffMask & (1UL << paramNo)))
+			continue;
+
+		if (paramTable[paramNo].size == 1)
+			value = (int8_t)data[0];
+		else
+			value = (int)(((unsigned int)data[0] << 8) | data[1]);
+
+		result = xbus->setCommand(channelID, paramTable[paramNo].order, &value);
+		if (result != kXBusError_NoError)
+			return result;
+
+		value = paramTable[paramNo].paramIndex;
+		result = xbus->setCommand(channelID, kXBusOrder_2_ParamWrite, &value);
+		if (result != kXBusError_NoError)
+			return result;
+
+		(*numOfFields)++;
+	}
+
+	return kXBusError_NoError;
+}
+
+
+//****************************************************************************
+//	XBusParamSnapshot::restoreAll
+//		return :		error code.  the last error if some servos fail
+//		parameter :	blob		the blob checked by check()
+//					numOfFields	number of the parameters restored in all servos
+//
+//		restore() all servos in the blob.  it goes on to the next servo
+//		when a servo fails
+//		2026/10/19 : add parameter snapshot
+//****************************************************************************
+XBusError XBusParamSnapshot::restoreAll(const uint8_t* blob, int* numOfFields)
+{
+	XBusError		result = kXBusError_NoError;
+	XBusError		error;
+	int				servoNo;
+	int				fields;
+
+	*numOfFields = 0;
+	for (servoNo = 0; servoNo < blob[3]; servoNo++)
+	{
+		error = restore(blob, blob[kXBusParamHeaderSize + servoNo * kXBusParamServoSize + kRecordID], &fields);
+		*numOfFields += fields;
+		if (error != kXBusError_NoError)
+			result = error;
+	}
+
+	return result;
+}
+
+
+//****************************************************************************
+//	XBusParamSnapshot::getParamOrder
+//		return :		the order of the parameter.  0 if paramNo is out of range
+//		parameter :	paramNo		bit number of the mask
+//
+//		2026/10/19 : add parameter snapshot
+//****************************************************************************
+char XBusParamSnapshot::getParamOrder(int paramNo)
+{
+	if ((paramNo < 0) || (paramNo >= kXBusParamNum))
+		return 0;
+
+	return paramTable[paramNo].order;
+}
+
+
+//****************************************************************************
+//	XBusParamSnapshot::findServo
+//		return :		the record of the servo.  NULL if not found
+//		parameter :	blob		the blob
+//					channelID	channel ID of the servo
+//
+//		2026/10/19 : add parameter snapshot
+//****************************************************************************
+const uint8_t* XBusParamSnapshot::findServo(const uint8_t* blob, char channelID)
+{
+	const uint8_t*	record = &blob[kXBusParamHeaderSize];
+	int				servoNo;
+
+	if ((blob[0] != kXBusParamMagic0) || (blob[1] != kXBusParamMagic1) || (blob[2] != kXBusParamVersion))
+		return NULL;
+
+	for (servoNo = 0; servoNo < blob[3]; servoNo++, record += kXBusParamServoSize)
+		if (record[kRecordID] == (uint8_t)channelID)
+			return record;
+
+	return NULL;
+}
+
+
+//****************************************************************************
+//	XBusParamSnapshot::readServo
+//		return :		error code
+//		parameter :	channelID	channel ID of the servo
+//					record		kXBusParamServoSize bytes to write
+//
+//		2026/10/19 : add parameter snapshot
+//****************************************************************************
+XBusError XBusParamSnapshot::readServo(char channelID, uint8_t* record)
+{
+	XBusError		result;
+	unsigned long	mask = 0;
+	uint8_t*		data = &record[kRecordValue];
+	int				paramNo;
+	int				value;
+
+	record[kRecordID] = channelID;
+	for (paramNo = 0; paramNo < kXBusParamNum; data += paramTable[paramNo].size, paramNo++)
+	{
+		value = 0;
+		result = xbus->getCommand(channelID, paramTable[paramNo].order, &value);
+		if (result == kXBusError_NoError)
+			mask |= 1UL << paramNo;
+		else if (result != kXBusError_Unsupported)
+			return result;
+		else
+			value = 0;
+
+		if (paramTable[paramNo].size == 1)
+			data[0] = value & 0xFF;
+		else
+		{
+			data[0] = (value >> 8) & 0xFF;
+			data[1] = value & 0xFF;
+		}
+	}
+
+	record[kRecordMask] = mask & 0xFF;
+	record[kRecordMask + 1] = (mask >> 8) & 0xFF;
+	record[kRecordMask + 2] = (mask >> 16) & 0xFF;
+	record[kRecordMask + 3] = (mask >> 24) & 0xFF;
+
+	return kXBusError_NoError;
+}
+
+
+//****************************************************************************
+//	XBusParamSnapshot::diffServo
+//		return :		error code
+//		parameter :	record		the record of the servo in the blob
+//					diffMask	the parameters different from the record
+//
+//		the parameters not in the mask of the record, and the parameters
+//		which the servo does not support are not compared
+//		2026/10/19 : add parameter snapshot
+//****************************************************************************
+XBusError XBusParamSnapshot::diffServo(const uint8_t* record, unsigned long* diffMask)
+{
+	XBusError		result;
+	const uint8_t*	data = &record[kRecordValue];
+	unsigned long	mask;
+	int				paramNo;
+	int				value;
+	bool			same;
+
+	mask = (unsigned long)record[kRecordMask] | ((unsigned long)record[kRecordMask + 1] << 8)
+			| ((unsigned long)record[kRecordMask + 2] << 16) | ((unsigned long)record[kRecordMask + 3] << 24);
+
+	*diffMask = 0;
+	for (paramNo = 0; paramNo < kXBusParamNum; data += paramTable[paramNo].size, paramNo++)
+	{
+		if (! (mask & (1UL << paramNo)))
+			continue;
+
+		value = 0;
+		result = xbus->getCommand(record[kRecordID], paramTable[paramNo].order, &value);
+		if (result == kXBusError_Unsupported)
+			continue;
+		if (result != kXBusError_NoError)
+			return result;
+
+		if (paramTable[paramNo].size == 1)
+			same = ((value & 0xFF) == data[0]);
+		else
+			same = (((value >> 8) & 0xFF) == data[0]) && ((value & 0xFF) == data[1]);
+		if (! same)
+			*diffMask |= 1UL << paramNo;
+	}
+
+	return kXBusError_NoError;
+}
@@ -0,0 +1,59 @@
+/* XBusParams.h file
+ *
+ * for Arduino
+ *
+ * snapshot, diff and restore of the servo parameters for XBusServoEx
+ */
+
+#ifndef XBusParams_h
+#define XBusParams_h
+#include "XBusServoEx.h"
+
+// the snapshot is kept in a blob given by the sketch, to be stored in
+// EEPROM or flash as it is :
+//	[0] [1]		kXBusParamMagic0, kXBusParamMagic1
+//	[2]			kXBusParamVersion
+//	[3]			number of servos (n)
+//	[4]			number of parameters of each servo (kXBusParamNum)
+//	then for each servo (kXBusParamServoSize bytes) :
+//		channel ID
+//		mask of the parameters read.  bit i for the parameter i.  little endian 4 bytes
+//		value of each parameter in the order of the table.  1 or 2 bytes, big endian
+//	[last]		crc8 of all bytes before
+// the channel ID (kParamIdx_ServoID) is not in the snapshot.
+
+#define	kXBusParamMagic0			'X'
+#define	kXBusParamMagic1			'P'
+#define	kXBusParamVersion			1
+#define	kXBusParamHeaderSize		5
+#define	kXBusParamNum				18
+#define	kXBusParamValueSize			27				// 9 parameters of 2 bytes and 9 of 1 byte
+#define	kXBusParamServoSize			(1 + 4 + kXBusParamValueSize)
+
+#define	XBusParamBlobSize(numOfServo)	(kXBusParamHeaderSize + (numOfServo) * kXBusParamServoSize + 1)
+
+
+class XBusParamSnapshot
+	{
+		public:
+			XBusParamSnapshot(XBusServoEx& servo);
+
+		public:
+			XBusError		snapshot(uint8_t* blob, unsigned int size);
+			XBusError		check(const uint8_t* blob, unsigned int size);
+			XBusError		diff(const uint8_t* blob, char channelID, unsigned long* diffMask);
+			XBusError		restore(const uint8_t* blob, char channelID, int* numOfFields);
+			XBusError		restoreAll(const uint8_t* blob, int* numOfFields);
+
+			static char		getParamOrder(int paramNo);
+
+		private:
+			XBusServoEx*	xbus;
+
+			const uint8_t*	findServo(const uint8_t* blob, char channelID);
+			XBusError		readServo(char channelID, uint8_t* record);
+			XBusError		diffServo(const uint8_t* record, unsigned long* diffMask);
+	};
+
+
+#endif	// of XBusParams_h
@@ -0,0 +1,239 @@
+/* XBusRecordRing.cpp file
+ *
+ * for Arduino
+ *
+ * lock-free ring buffer of time stamped XBus packets
+ */
+
+#include "XBusRecordRing.h"
+
+
+//****************************************************************************
+//	XBusRecordRing::XBusRecordRing
+//		return :		none
+//		parameter :	ringBuffer	buffer for the records
+//					ringSize	size of ringBuffer.  it must be power of 2
+//
+//		Constructor
+//		2026/10/19 : split from XBusSniffer
+//****************************************************************************
+XBusRecordRing::XBusRecordRing(uint8_t* ringBuffer, unsigned int ringSize)
+{
+	ring = ringBuffer;
+	ringMask = ringSize - 1;
+	ringHead = 0;
+	ringTail = 0;
+	records = 0;
+	overflows = 0;
+}
+
+
+//****************************************************************************
+//	XBusRecordRing::push
+//		return :		none
+//		parameter :	type		type of the record
+//					packet		packet to record
+//					size		size of the packet
+//					time		micros() at the start of the packet
+//
+//		producer side of the ring buffer.  only ringHead is written here, and
+//		it is updated after the record is written.  so the reader does not need
+//		to disable the interrupt.  the record is lost if the ring buffer is full
+//		2026/10/19 : split from XBusSniffer
+//		2026/10/19 : load ringTail with loadIndex
+//****************************************************************************
+void XBusRecordRing::push(XBusRecordType type, const uint8_t* packet, uint8_t size, unsigned long time)
+{
+	unsigned int	head = ringHead;
+	unsigned int	tail = loadIndex(ringTail);
+	unsigned int	recordSize = kXBusRecordHeaderSize + size;
+	uint8_t			header[kXBusRecordHeaderSize];
+	uint8_t			index;
+
+	if (recordSize > ringMask + 1 - (head - tail))
+	{
+		overflows++;
+		return;
+	}
+
+	header[0] = type;
+	header[1] = time & 0xFF;
+	header[2] = (time >> 8) & 0xFF;
+	header[3] = (time >> 16) & 0xFF;
+	header[4] = (time >> 24) & 0xFF;
+	header[5] = size;
+
+	for (index = 0; index < kXBusRecordHeaderSize; index++)
+		ring[(head++) & ringMask] = header[index];
+	for (index = 0; index < size; index++)
+		ring[(head++) & ringMask] = packet[index];
+
+	XBUS_MEMORY_BARRIER();
+	ringHead = head;
+	records++;
+}
+
+
+//****************************************************************************
+//	XBusRecordRing::read
+//		return :		size of the packet.  0 if no record, -1 if packet is larger than packetSize
+//		parameter :	packet		buffer to get the packet
+//					packetSize	size of the buffer
+//					time		micros() at the start of the packet.  can be NULL
+//					type		type of the record.  can be NULL
+//
+//		consumer side of the ring buffer.  get one record and copy the packet
+//		from the ring buffer to the caller's buffer.  only ringTail is written
+//		here.  the packet too large for the buffer is removed from the ring buffer
+//		2026/10/19 : split from XBusSniffer
+//		2026/10/19 : copy the packet from the ring buffer without the record buffer
+//****************************************************************************
+int XBusRecordRing::read(uint8_t* packet, int packetSize, unsigned long* time, XBusRecordType* type)
+{
+	unsigned int	head;
+	unsigned int	tail = loadIndex(ringTail);
+	uint8_t			header[kXBusRecordHeaderSize];
+	int				size;
+	int				index;
+
+	head = loadIndex(ringHead);
+	if (head == tail)
+		return 0;
+	XBUS_MEMORY_BARRIER();
+
+	for (index = 0; index < kXBusRecordHeaderSize; index++)
+		header[index] = ring[(tail + index) & ringMask];
+	size = header[kXBusRecordHeaderSize - 1];
+
+	if (size <= packetSize)
+	{
+		for (index = 0; index < size; index++)
+			packet[index] = ring[(tail + kXBusRecordHeaderSize + index) & ringMask];
+
+		if (time != NULL)
+			*time = (unsigned long)header[1] | ((unsigned long)header[2] << 8)
+					| ((unsigned long)header[3] << 16) | ((unsigned long)header[4] << 24);
+		if (type != NULL)
+			*type = (XBusRecordType)header[0];
+	}
+
+	XBUS_MEMORY_BARRIER();
+	storeIndex(ringTail, tail + kXBusRecordHeaderSize + size);
+
+	return (size <= packetSize) ? size : -1;
+}
+
+
+//****************************************************************************
+//	XBusRecordRing::dump
+//		return :		bytes written
+//		parameter :	out			destination of the records
+//
+//		write all records in the record format.  the records are kept in the
+//		ring buffer with the same format, so they are written from the ring
+//		buffer as they are.  2 writes when they wrap around the end
+//		2026/10/19 : split from XBusSniffer
+//		2026/10/19 : write from the ring buffer without the record buffer
+//****************************************************************************
+size_t XBusRecordRing::dump(Print& out)
+{
+	unsigned int	head;
+	unsigned int	tail = loadIndex(ringTail);
+	unsigned int	top;
+	unsigned int	size;
+	size_t			written = 0;
+
+	head = loadIndex(ringHead);
+	if (head == tail)
+		return 0;
+	XBUS_MEMORY_BARRIER();
+
+	top = tail & ringMask;
+	size = head - tail;
+	if (top + size > ringMask + 1)
+	{
+		written += out.write(&ring[top], ringMask + 1 - top);
+		size -= ringMask + 1 - top;
+		top = 0;
+	}
+	written += out.write(&ring[top], size);
+
+	XBUS_MEMORY_BARRIER();
+	storeIndex(ringTail, head);
+
+	return written;
+}
+
+
+//****************************************************************************
+//	XBusRecordRing::clear
+//		return :		none
+//		parameter :	none
+//
+//		remove all records.  this is the reader side
+//		2026/10/19 : add trace recorder
+//****************************************************************************
+void XBusRecordRing::clear(void)
+{
+	storeIndex(ringTail, loadIndex(ringHead));
+}
+
+
+//****************************************************************************
+//	XBusRecordRing::recordCount / overflowCount
+//		return :		records pushed / records lost by the full ring buffer
+//		parameter :	none
+//
+//		2026/10/19 : split from XBusSniffer
+//****************************************************************************
+unsigned long XBusRecordRing::recordCount(void)
+{
+	return records;
+}
+
+unsigned long XBusRecordRing::overflowCount(void)
+{
+	return overflows;
+}
+
+
+//****************************************************************************
+//	XBusRecordRing::loadIndex / storeIndex
+//		return :		value of the index / none
+//		parameter :	index		ringHead or ringTail
+//					value		new value
+//
+//		access the index shared with push called from the interrupt.
+//		on AVR, 16 bit index is not accessed atomically.  so the interrupt is
+//		disabled while the index is accessed, and restored as it was for push
+//		called in the interrupt
+//		2026/10/19 : split from XBusSniffer
+//		2026/10/19 : restore the interrupt flag
+//****************************************************************************
+unsigned int XBusRecordRing::loadIndex(volatile unsigned int& index)
+{
+#if defined(__AVR__)
+	uint8_t			oldSREG = SREG;
+	unsigned int	value;
+
+	noInterrupts();
+	value = index;
+	SREG = oldSREG;
+	return value;
+#else
+	return index;
+#endif
+}
+
+void XBusRecordRing::storeIndex(volatile unsigned int& index, unsigned int value)
+{
+#if defined(__AVR__)
+	uint8_t			oldSREG = SREG;
+
+	noInterrupts();
+	index = value;
+	SREG = oldSREG;
+#else
+	index = value;
+#endif
+}
@@ -0,0 +1,60 @@
+/* XBusRecordRing.h file
+ *
+ * for Arduino
+ *
+ * lock-free ring buffer of time stamped XBus packets
+ */
+
+#ifndef XBusRecordRing_h
+#define XBusRecordRing_h
+#include "XBusServoEx.h"
+
+// record format (all multi byte values are little endian)
+//
+//	type				XBusRecordType
+//	time				4 bytes. micros() at the start of the first byte of the packet
+//	size				size of the packet
+//	packet				size bytes.  whole XBus packet including the CRC
+//						(1 byte XBusError for kXBusRecord_Error)
+//
+// records are kept in the ring buffer with the same format, and dump() writes
+// them as is.  extras/xbus_sniff_decode.cpp decodes the dumped data on the host.
+#define	kXBusRecordHeaderSize		6
+
+typedef enum
+{
+	kXBusRecord_Sniff =				0x5A,		// packet captured by XBusSniffer
+	kXBusRecord_Frame =				0x46,		// 'F' channel data packet sent
+	kXBusRecord_Command =			0x43,		// 'C' command packet sent
+	kXBusRecord_Response =			0x52,		// 'R' response received
+	kXBusRecord_Error =				0x45		// 'E' command finished with error
+} XBusRecordType;
+
+
+class XBusRecordRing
+	{
+		public:
+			XBusRecordRing(uint8_t* ringBuffer, unsigned int ringSize);
+
+		public:
+			void			push(XBusRecordType type, const uint8_t* packet, uint8_t size, unsigned long time);
+			int				read(uint8_t* packet, int packetSize, unsigned long* time, XBusRecordType* type);
+			size_t			dump(Print& out);
+			void			clear(void);
+			unsigned long	recordCount(void);
+			unsigned long	overflowCount(void);
+
+		private:
+			uint8_t*		ring;
+			unsigned int	ringMask;					// ring size - 1.  ring size is power of 2
+			volatile unsigned int	ringHead;			// written by push only
+			volatile unsigned int	ringTail;			// written by read / dump only
+			unsigned long	records;
+			unsigned long	overflows;
+
+			static unsigned int	loadIndex(volatile unsigned int& index);
+			static void		storeIndex(volatile unsigned int& index, unsigned int value);
+	};
+
+
+#endif	// of XBusRecordRing_h
@@ -0,0 +1,286 @@
+/* XBusRxParser.cpp file
+ *
+ * for Arduino
+ *
+ * byte by byte XBus packet parser
+ *
+ * the framing (the header, the length and the CRC at the end) is shared with
+ * the other byte streams.  the rule gives the size of the frame from the
+ * bytes at the top, and the parser does the resync and the CRC
+ */
+
+#include "XBusServoEx.h"
+
+#define	kPacketCommand			0
+#define	kPacketLength			1
+#define	kMinPacketLength		2				// key and type of the channel data packet
+
+
+//****************************************************************************
+//	XBusRxParser::XBusRxParser
+//		return :		none
+//		parameter :	buffer		buffer for the packet.  it should be large enough
+//								for the largest packet to receive
+//					bufferSize	size of the buffer
+//					rule		size of the frame.  NULL for the XBus packet
+//
+//		Constructor
+//		2026/10/19 : add streaming parser
+//		2026/10/19 : add frame rule
+//****************************************************************************
+XBusRxParser::XBusRxParser(uint8_t* buffer, uint8_t bufferSize, XBusFrameRule rule)
+{
+	frameRule = (rule != NULL) ? rule : packetRule;
+	rxBuffer = buffer;
+	rxBufferSize = bufferSize;
+	crcErrors = 0;
+	droppedBytes = 0;
+	reset();
+}
+
+
+//****************************************************************************
+//	XBusRxParser::reset
+//		return :		none
+//		parameter :	none
+//
+//		discard the bytes received
+//		2026/10/19 : add streaming parser
+//****************************************************************************
+void XBusRxParser::reset(void)
+{
+	rxStart = 0;
+	rxCount = 0;
+	rxSize = 0;
+	rxCRC = 0;
+	rxCRCValid = true;
+}
+
+
+//****************************************************************************
+//	XBusRxParser::feed
+//		return :		true when a packet with the right CRC is completed
+//		parameter :	data		received byte
+//
+//		put one byte to the parser.  this can be called from the RX interrupt.
+//		the length and the CRC are checked while the bytes arrive, and
+//		if the packet is broken, it searches the next header from the byte
+//		after the broken header.
+//		the packet is kept in the buffer until the next call.  call next()
+//		after the packet is used, for the packets already in the buffer
+//		2026/10/19 : add streaming parser
+//		2026/10/19 : move the bytes only at the end of the buffer
+//****************************************************************************
+bool XBusRxParser::feed(uint8_t data)
+{
+	// remove the packet completed at the last call
+	if (rxSize != 0)
+	{
+		drop(rxSize);
+		rxSize = 0;
+	}
+
+	if (rxCount >= rxBufferSize)
+		drop(1);
+
+	// the bytes are moved to the top only when the end of the buffer is reached
+	if (rxStart + rxCount >= rxBufferSize)
+	{
+		memmove(rxBuffer, &rxBuffer[rxStart], rxCount);
+		rxStart = 0;
+	}
+
+	rxBuffer[rxStart + rxCount++] = data;
+	if (rxCRCValid)
+		rxCRC = XBusServoEx::crc_table(data, rxCRC);
+
+	return scan();
+}
+
+
+//****************************************************************************
+//	XBusRxParser::next
+//		return :		true when the next packet is completed
+//		parameter :	none
+//
+//		remove the packet completed and check the bytes received after it.
+//		the packet after it may be already in the buffer when the bytes are
+//		fed at once, and it is completed here without waiting for the next byte.
+//		call this until it returns false
+//		2026/10/19 : check the bytes after the packet at once
+//****************************************************************************
+bool XBusRxParser::next(void)
+{
+	if (rxSize == 0)
+		return false;
+
+	drop(rxSize);
+	rxSize = 0;
+
+	return scan();
+}
+
+
+//****************************************************************************
+//	XBusRxParser::packet
+//		return :		top of the completed packet
+//		parameter :	none
+//
+//		2026/10/19 : add streaming parser
+//****************************************************************************
+uint8_t* XBusRxParser::packet(void)
+{
+	return &rxBuffer[rxStart];
+}
+
+
+//****************************************************************************
+//	XBusRxParser::packetSize
+//		return :		size of the completed packet.  0 if not completed
+//		parameter :	none
+//
+//		2026/10/19 : add streaming parser
+//****************************************************************************
+uint8_t XBusRxParser::packetSize(void)
+{
+	return rxSize;
+}
+
+
+//****************************************************************************
+//	XBusRxParser::pendingSize
+//		return :		bytes received for the packet not completed yet
+//		parameter :	none
+//
+//		2026/10/19 : add streaming parser
+//****************************************************************************
+uint8_t XBusRxParser::pendingSize(void)
+{
+	return rxCount - rxSize;
+}
+
+
+//****************************************************************************
+//	XBusRxParser::crcErrorCount / droppedCount
+//		return :		number of packets with CRC error / bytes dropped for resync
+//		parameter :	none
+//
+//		2026/10/19 : add streaming parser
+//****************************************************************************
+unsigned int XBusRxParser::crcErrorCount(void)
+{
+	return crcErrors;
+}
+
+unsigned int XBusRxParser::droppedCount(void)
+{
+	return droppedBytes;
+}
+
+
+//****************************************************************************
+//	XBusRxParser::scan
+//		return :		true when a packet is completed
+//		parameter :	none
+//
+//		check the bytes in the buffer from the top.  drop the top byte until
+//		it looks like the header of the frame.  the CRC is calculated again
+//		only when the frame after the dropped bytes is completed
+//		2026/10/19 : add streaming parser
+//		2026/10/19 : calculate the CRC once for the packet after the resync
+//		2026/10/19 : get the size from the frame rule
+//****************************************************************************
+bool XBusRxParser::scan(void)
+{
+	while (rxCount > 0)
+	{
+		uint8_t*	top = &rxBuffer[rxStart];
+		int			size = frameRule(top, rxCount, rxBufferSize);
+
+		if (size == kXBusFrame_NoHeader)
+		{
+			drop(1);
+			continue;
+		}
+
+		if (size == kXBusFrame_Broken)
+		{
+			crcErrors++;
+			drop(1);
+			continue;
+		}
+
+		if ((size == kXBusFrame_More) || (rxCount < size))
+			return false;
+
+		// CRC of whole packet including the CRC is 0
+		if ((((rxCount == size) && rxCRCValid) ? rxCRC : XBusServoEx::crc8(top, size)) == 0)
+		{
+			rxSize = size;
+			return true;
+		}
+
+		crcErrors++;
+		drop(1);
+	}
+
+	return false;
+}
+
+
+//****************************************************************************
+//	XBusRxParser::packetRule
+//		return :		size of the packet, or kXBusFrame_More / kXBusFrame_NoHeader
+//		parameter :	top			top of the bytes received
+//					count		number of the bytes
+//					bufferSize	size of the buffer
+//
+//		frame rule of the XBus packet.  the command and the length byte
+//		2026/10/19 : add frame rule
+//****************************************************************************
+int XBusRxParser::packetRule(const uint8_t* top, uint8_t count, uint8_t bufferSize)
+{
+	uint8_t		command = top[kPacketCommand];
+
+	if ((command != kXBusCmd_Set) && (command != kXBusCmd_Get)
+			&& (command != kXBusCmd_Status) && (command != kXBusCmd_ModeA))
+		return kXBusFrame_NoHeader;
+
+	if (count <= kPacketLength)
+		return kXBusFrame_More;
+
+	if ((top[kPacketLength] < kMinPacketLength) || (top[kPacketLength] > bufferSize - 3))
+		return kXBusFrame_NoHeader;
+
+	return top[kPacketLength] + 3;					// add 3 for command, length and CRC
+}
+
+
+//****************************************************************************
+//	XBusRxParser::drop
+//		return :		none
+//		parameter :	size		bytes to drop from the top of the buffer
+//
+//		the bytes are not moved and the CRC is not calculated here, so the
+//		resync over n bytes does not take n * n
+//		2026/10/19 : add streaming parser
+//		2026/10/19 : move the top instead of the bytes
+//****************************************************************************
+void XBusRxParser::drop(uint8_t size)
+{
+	if (rxSize == 0)
+		droppedBytes += (size < rxCount) ? size : rxCount;
+
+	if (size >= rxCount)
+	{
+		rxStart = 0;
+		rxCount = 0;
+		rxCRC = 0;
+		rxCRCValid = true;
+		return;
+	}
+
+	rxStart += size;
+	rxCount -= size;
+	rxCRCValid = false;
+}
@@ -0,0 +1,60 @@
+/* XBusRxParser.h file
+ *
+ * for Arduino
+ *
+ * byte by byte XBus packet parser
+ *
+ * the framing (the header, the length and the CRC at the end) is shared with
+ * the other byte streams.  the rule gives the size of the frame from the
+ * bytes at the top, and the parser does the resync and the CRC
+ */
+
+#ifndef XBusRxParser_h
+#define XBusRxParser_h
+#include "arduino.h"
+
+// return value of XBusFrameRule other than the size of the frame
+#define	kXBusFrame_More				0			// more bytes are needed for the size
+#define	kXBusFrame_NoHeader			-1			// the top byte is not a header.  dropped
+#define	kXBusFrame_Broken			-2			// the header is broken.  dropped and counted as CRC error
+
+// size of the frame from the bytes at the top of the buffer.  count is the
+// number of the bytes at top, and the frame must fit in bufferSize
+typedef int	(*XBusFrameRule)(const uint8_t* top, uint8_t count, uint8_t bufferSize);
+
+
+class XBusRxParser
+	{
+		public:
+			XBusRxParser(uint8_t* buffer, uint8_t bufferSize, XBusFrameRule rule = NULL);
+
+		public:
+			void			reset(void);
+			bool			feed(uint8_t data);
+			bool			next(void);
+			uint8_t*		packet(void);
+			uint8_t			packetSize(void);
+			uint8_t			pendingSize(void);
+			unsigned int	crcErrorCount(void);
+			unsigned int	droppedCount(void);
+
+		private:
+			XBusFrameRule	frameRule;
+			uint8_t*		rxBuffer;
+			uint8_t			rxBufferSize;
+			uint8_t			rxStart;				// top of the bytes in rxBuffer
+			uint8_t			rxCount;				// bytes in rxBuffer from rxStart
+			uint8_t			rxSize;					// size of the completed packet.  0 while receiving
+			uint8_t			rxCRC;					// CRC of the bytes from rxStart
+			bool			rxCRCValid;				// false after the top is dropped in the middle
+			unsigned int	crcErrors;
+			unsigned int	droppedBytes;
+
+			bool			scan(void);
+			void			drop(uint8_t size);
+
+			static int		packetRule(const uint8_t* top, uint8_t count, uint8_t bufferSize);
+	};
+
+
+#endif	// of XBusRxParser_h
@@ -0,0 +1,296 @@
+/* XBusScheduler.cpp file
+ *
+ * for Arduino
+ *
+ * frame scheduler of several XBus buses with the phase offsets
+ */
+
+#include "XBusScheduler.h"
+
+
+//****************************************************************************
+//	XBusScheduler::XBusScheduler
+//		return :		none
+//		parameter :	none
+//
+//		Constructor
+//		2026/10/19 : add multi bus scheduler
+//****************************************************************************
+XBusScheduler::XBusScheduler(void)
+{
+	numOfBus = 0;
+	interval = kXBusInterval * 1000L;
+	running = false;
+	peakTickTime = 0;
+	peakBusesPerTick = 0;
+}
+
+
+//****************************************************************************
+//	XBusScheduler::addBus
+//		return :		error code
+//		parameter :	servo		XBusServoEx of the bus.  begin() to begin5() is called
+//					serialNo	0 to 5 for the port opened by begin() to begin5()
+//					phaseUSec	offset of the frame in the period (0 to interval - 1)
+//
+//		add the bus before start().  kXBusError_BusBusy after start(), and
+//		kXBusError_Unsupported for the port which the board does not have
+//		2026/10/19 : add multi bus scheduler
+//		2026/10/19 : check the port with the same conditions as send()
+//****************************************************************************
+XBusError XBusScheduler::addBus(XBusServoEx& servo, int serialNo, unsigned long phaseUSec)
+{
+	Bus*	target;
+
+	if (running)
+		return kXBusError_BusBusy;
+	if (numOfBus >= kXBusSchedulerMaxBus)
+		return kXBusError_ServoNumOverflow;
+
+	// the ports compiled in send()
+	switch (serialNo)
+	{
+		case 0:
+#if defined(ARDUINO_AVR_MEGA2560) || defined(ARDUINO_ARCH_ESP32) || defined(__IMXRT1062__)
+		case 1:
+		case 2:
+#endif
+#if defined(ARDUINO_AVR_MEGA2560) || defined(__IMXRT1062__)
+		case 3:
+#endif
+#if defined(__IMXRT1062__)
+		case 4:
+		case 5:
+#endif
+			break;
+		default:
+			return kXBusError_Unsupported;
+	}
+
+	target = &bus[numOfBus];
+	target->xbus = &servo;
+	target->serialNo = serialNo;
+	target->phase = phaseUSec % interval;
+	target->nextTime = 0;
+	target->peakTime = 0;
+	numOfBus++;
+
+	return kXBusError_NoError;
+}
+
+
+//****************************************************************************
+//	XBusScheduler::spreadPhases
+//		return :		none
+//		parameter :	none
+//
+//		put the frames of the buses at the same distance in the period.
+//		call this after addBus() and before start()
+//		2026/10/19 : add multi bus scheduler
+//****************************************************************************
+void XBusScheduler::spreadPhases(void)
+{
+	int		busNo;
+
+	if (running)
+		return;
+
+	for (busNo = 0; busNo < numOfBus; busNo++)
+		bus[busNo].phase = interval * busNo / numOfBus;
+}
+
+
+//****************************************************************************
+//	XBusScheduler::setInterval
+//		return :		none
+//		parameter :	intervalUSec	period of the frames.  kXBusInterval by default
+//
+//		call this before addBus()
+//		2026/10/19 : add multi bus scheduler
+//****************************************************************************
+void XBusScheduler::setInterval(unsigned long intervalUSec)
+{
+	if ((! running) && (intervalUSec > 0))
+		interval = intervalUSec;
+}
+
+
+//****************************************************************************
+//	XBusScheduler::start
+//		return :		none
+//		parameter :	none
+//
+//		start the period now.  call tick() after this
+//		2026/10/19 : add multi bus scheduler
+//****************************************************************************
+void XBusScheduler::start(void)
+{
+	unsigned long	now = micros();
+	int				busNo;
+
+	for (busNo = 0; busNo < numOfBus; busNo++)
+		bus[busNo].nextTime = now + bus[busNo].phase;
+	clearPeak();
+	running = true;
+}
+
+
+//****************************************************************************
+//	XBusScheduler::tick
+//		return :		none
+//		parameter :	none
+//
+//		send the frames whose time has come.  call this from a timer
+//		interrupt faster than the phase resolution (e.g. 1mSec with MsTimer2)
+//		or from loop().  a frame late for more than one period is not sent
+//		twice.  the CPU time of the tick and of each bus is recorded
+//		2026/10/19 : add multi bus scheduler
+//****************************************************************************
+void XBusScheduler::tick(void)
+{
+	unsigned long	start;
+	unsigned long	now;
+	unsigned long	elapsed;
+	uint8_t			sent = 0;
+	int				busNo;
+
+	if (! running)
+		return;
+
+	start = micros();
+	for (busNo = 0; busNo < numOfBus; busNo++)
+	{
+		Bus*	target = &bus[busNo];
+
+		if ((long)(start - target->nextTime) < 0)
+			continue;
+
+		now = micros();
+		send(target);
+		elapsed = micros() - now;
+		if (elapsed > target->peakTime)
+			target->peakTime = elapsed;
+		sent++;
+
+		target->nextTime += interval;
+		if ((long)(start - target->nextTime) >= 0)
+			target->nextTime = start + interval;				// start the schedule again
+	}
+
+	if (sent == 0)
+		return;
+
+	elapsed = micros() - start;
+	if (elapsed > peakTickTime)
+		peakTickTime = elapsed;
+	if (sent > peakBusesPerTick)
+		peakBusesPerTick = sent;
+}
+
+
+//****************************************************************************
+//	XBusScheduler::getPeakTickTime / getPeakBusTime / getPeakBusesPerTick
+//		return :		max uSec of one tick / max uSec of one frame of the bus /
+//						max frames sent in one tick
+//		parameter :	busNo		index of the bus in the order it was added
+//
+//		the peaks since start() or clearPeak()
+//		2026/10/19 : add multi bus scheduler
+//****************************************************************************
+unsigned long XBusScheduler::getPeakTickTime(void)
+{
+	return readPeak(&peakTickTime);
+}
+
+unsigned long XBusScheduler::getPeakBusTime(int busNo)
+{
+	if ((busNo < 0) || (busNo >= numOfBus))
+		return 0;
+
+	return readPeak(&bus[busNo].peakTime);
+}
+
+uint8_t XBusScheduler::getPeakBusesPerTick(void)
+{
+	return peakBusesPerTick;
+}
+
+
+//****************************************************************************
+//	XBusScheduler::clearPeak
+//		return :		none
+//		parameter :	none
+//
+//		2026/10/19 : add multi bus scheduler
+//****************************************************************************
+void XBusScheduler::clearPeak(void)
+{
+	int		busNo;
+
+	noInterrupts();
+	peakTickTime = 0;
+	peakBusesPerTick = 0;
+	for (busNo = 0; busNo < numOfBus; busNo++)
+		bus[busNo].peakTime = 0;
+	interrupts();
+}
+
+
+//****************************************************************************
+//	XBusScheduler::readPeak
+//		return :		the value
+//		parameter :	value		the value written by tick()
+//
+//		read the value written in the timer interrupt without tearing
+//		2026/10/19 : add multi bus scheduler
+//****************************************************************************
+unsigned long XBusScheduler::readPeak(volatile unsigned long* value)
+{
+	unsigned long	result;
+
+	noInterrupts();
+	result = *value;
+	interrupts();
+
+	return result;
+}
+
+
+//****************************************************************************
+//	XBusScheduler::send
+//		return :		none
+//		parameter :	target		the bus
+//
+//		the ports here must be the same as addBus()
+//		2026/10/19 : add multi bus scheduler
+//****************************************************************************
+void XBusScheduler::send(Bus* target)
+{
+	switch (target->serialNo)
+	{
+		case 0:
+			target->xbus->sendChannelDataPacket();
+			break;
+#if defined(ARDUINO_AVR_MEGA2560) || defined(ARDUINO_ARCH_ESP32) || defined(__IMXRT1062__)
+		case 1:
+			target->xbus->sendChannelDataPacket1();
+			break;
+		case 2:
+			target->xbus->sendChannelDataPacket2();
+			break;
+#endif
+#if defined(ARDUINO_AVR_MEGA2560) || defined(__IMXRT1062__)
+		case 3:
+			target->xbus->sendChannelDataPacket3();
+			break;
+#endif
+#if defined(__IMXRT1062__)
+		case 4:
+			target->xbus->sendChannelDataPacket4();
+			break;
+		case 5:
+			target->xbus->sendChannelDataPacket5();
+			break;
+#endif
+	}
+}
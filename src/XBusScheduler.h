@@ -0,0 +1,54 @@
+/* XBusScheduler.h file
+ *
+ * for Arduino
+ *
+ * frame scheduler of several XBus buses with the phase offsets
+ */
+
+#ifndef XBusScheduler_h
+#define XBusScheduler_h
+#include "XBusServoEx.h"
+
+#define	kXBusSchedulerMaxBus		6				// Serial to Serial5
+
+
+class XBusScheduler
+	{
+		public:
+			XBusScheduler(void);
+
+		public:
+			XBusError		addBus(XBusServoEx& servo, int serialNo, unsigned long phaseUSec);
+			void			spreadPhases(void);
+			void			setInterval(unsigned long intervalUSec);
+			void			start(void);
+			void			tick(void);
+
+			unsigned long	getPeakTickTime(void);
+			unsigned long	getPeakBusTime(int busNo);
+			uint8_t			getPeakBusesPerTick(void);
+			void			clearPeak(void);
+
+		private:
+			typedef struct
+			{
+				XBusServoEx*	xbus;
+				uint8_t			serialNo;				// 0 to 5 for sendChannelDataPacket to sendChannelDataPacket5
+				unsigned long	phase;					// uSec from the start of the period
+				unsigned long	nextTime;				// micros() to send the next frame
+				volatile unsigned long	peakTime;		// max uSec to build and queue a frame
+			} Bus;
+
+			Bus				bus[kXBusSchedulerMaxBus];
+			uint8_t			numOfBus;
+			unsigned long	interval;					// uSec
+			bool			running;
+			volatile unsigned long	peakTickTime;		// max uSec of one tick
+			volatile uint8_t	peakBusesPerTick;	// max frames sent in one tick
+
+			void			send(Bus* target);
+			unsigned long	readPeak(volatile unsigned long* value);
+	};
+
+
+#endif	// of XBusScheduler_h
@@ -8,8 +8,18 @@
  */
 
 #include "XBusServoEx.h"
+#include "XBusRecordRing.h"
 
-#define	kXBusBaudrate			250000			// bps
+#if defined(XBUS_ECHO_MARGIN)
+#define	kXBusEchoMargin			XBUS_ECHO_MARGIN	// for the port with the long latency like the USB-UART adapter
+#else
+#define	kXBusEchoMargin			1000			// uSec.  the echo must come within the packet time and this
+#endif
+#if defined(XBUS_RESPONSE_MARGIN)
+#define	kXBusResponseMargin		XBUS_RESPONSE_MARGIN
+#else
+#define	kXBusResponseMargin		2000			// uSec.  the response must come within the command time, the echo margin and this
+#endif
 
 #define	kStartOffsetOfCHData	4
 #define	kCHDataSize				4
@@ -29,16 +39,6 @@
 #define	kCmdDataPacketCRC		7
 
 
-// XBus Command
-typedef enum
-{
-	kXBusCmd_Set =				0x20,
-	kXBusCmd_Get =				0x21,
-	kXBusCmd_Status =			0x22,
-	kXBusCmd_ModeA =			0xa4
-} XBusCmd; 
-
-
 // XBUS device mode
 typedef enum
 {
@@ -47,6 +47,40 @@ typedef enum
 } XBusMode;
 
 
+#if defined(__AVR__) && ! defined(XBUS_NO_TX_COMPLETE_ISR)
+// TX complete interrupt of the USART turns the bus to Rx just after the stop bit
+// of the last byte of the command.  HardwareSerial of Arduino does not use it.
+// define XBUS_NO_TX_COMPLETE_ISR if the other library uses it.  it must be given
+// to the compiler (e.g. -DXBUS_NO_TX_COMPLETE_ISR), because #define in the
+// sketch does not reach this file
+#define	XBUS_USE_TX_COMPLETE_ISR
+static volatile uint8_t*	s_txDirPort[4];			// port register of the direction pin for each USART
+static uint8_t				s_txDirMask[4];
+
+#define	XBUS_TX_COMPLETE_ISR(vect, no, ucsrb, txcie)		\
+	ISR(vect)												\
+	{														\
+		*s_txDirPort[no] |= s_txDirMask[no];				\
+		ucsrb &= ~(1 << txcie);								\
+	}
+
+#if defined(USART_TX_vect)
+XBUS_TX_COMPLETE_ISR(USART_TX_vect, 0, UCSR0B, TXCIE0)
+#elif defined(USART0_TX_vect)
+XBUS_TX_COMPLETE_ISR(USART0_TX_vect, 0, UCSR0B, TXCIE0)
+#endif
+#if defined(USART1_TX_vect)
+XBUS_TX_COMPLETE_ISR(USART1_TX_vect, 1, UCSR1B, TXCIE1)
+#endif
+#if defined(USART2_TX_vect)
+XBUS_TX_COMPLETE_ISR(USART2_TX_vect, 2, UCSR2B, TXCIE2)
+#endif
+#if defined(USART3_TX_vect)
+XBUS_TX_COMPLETE_ISR(USART3_TX_vect, 3, UCSR3B, TXCIE3)
+#endif
+#endif
+
+
 
 //****************************************************************************
 //	XBusServoEx::XBusServoEx
@@ -60,15 +94,29 @@ typedef enum
 //		Constructor
 //		2014/05/14 : add header by Sawa
 //		2014/10/09 : move memory allocation from here to begin()
+//		2026/10/19 : cache the port register of the direction pin
 //****************************************************************************
 XBusServoEx::XBusServoEx(int dirPin, unsigned int maxServoNum)
+	: rxParser(rxBuffer, sizeof(rxBuffer))
 {
 	// initialize pin config
 	dirPinNo = dirPin;
+	dirPort = NULL;
+	dirMask = 0;
+	txUCSRB = NULL;
+	txcieBit = 0;
+	txUSARTNo = -1;
 	if (dirPinNo >= 0)
 	{
 		pinMode(dirPinNo, OUTPUT);
 		digitalWrite(dirPinNo, LOW);
+#if defined(__AVR__)
+		if (digitalPinToPort(dirPinNo) != NOT_A_PORT)
+		{
+			dirPort = portOutputRegister(digitalPinToPort(dirPinNo));
+			dirMask = digitalPinToBitMask(dirPinNo);
+		}
+#endif
 	}
 
 	// initialise vars
@@ -78,10 +126,42 @@ XBusServoEx::XBusServoEx(int dirPin, unsigned int maxServoNum)
 		maxServo = kXBusMaxServoNum;
 	else if (maxServo == 0)
 		maxServo = 1;
-	dirty = 0;
-	modifyServosNow = 0;
+	servoSeq = 0;
+	builtSeq = 1;
+	builtSize = 0;
 	chPacketBuffer = NULL;
 	sendBuffer = NULL;
+	slewValue = NULL;
+	slewStep = NULL;
+	slewMaxStep = NULL;
+	slewMaxAccel = NULL;
+	slewing = 0;
+	sentValue = NULL;
+	partialRefresh = 0;
+	partialCount = 0;
+	rateDivider = NULL;
+	subFrameCount = 0;
+	calTable = NULL;
+	calShift = NULL;
+	virtualValue = NULL;
+	virtualScale = NULL;
+	virtualOffset = NULL;
+	virtualSource = NULL;
+	admissionMode = kXBusAdmission_Off;
+	frameInterval = kXBusInterval * 1000L;
+	frameStartTime = 0;
+	frameCount = 0;
+	lastFrameSize = 0;
+	xbusSerial = NULL;
+	commandBusy = 0;
+	cmdResult = kXBusError_NoError;
+	cmdSendTime = 0;
+	cmdTimeOut = 0;
+	cmdWaitTime = 0;
+	retryMaxAttempts = 1;
+	retryBackoffFrames = 1;
+	servoStats = NULL;
+	traceRecorder = NULL;
 }
 
 
@@ -96,6 +176,50 @@ XBusServoEx::XBusServoEx(int dirPin, unsigned int maxServoNum)
 //					 add to check memory allocation
 //****************************************************************************
 XBusError XBusServoEx::begin(void)
+{
+	XBusError		result;
+
+	result = allocBuffers();
+	if (result != kXBusError_NoError)
+		return result;
+
+	Serial.begin(kXBusBaudrate);
+	Serial.setTimeout(300);
+	xbusSerial = &Serial;
+	setTxUSART(0);
+
+	return kXBusError_NoError;
+}
+
+//****************************************************************************
+//	XBusServoEx::end
+//		return :	none
+//		parameter :	none
+//
+//		This should be called when finishing XBus.
+//		2014/05/14 : add header by Sawa
+//		2014/10/09 : move memory free from destructor to here
+//****************************************************************************
+void XBusServoEx::end(void)
+{
+	Serial.end();
+	xbusSerial = NULL;
+	setTxUSART(-1);
+	pinMode(this->dirPinNo, INPUT);
+
+	freeBuffers();
+}
+
+
+//****************************************************************************
+//	XBusServoEx::allocBuffers
+//		return :	error code
+//		parameter :	none
+//
+//		allocate the packet buffers.  common part of begin() to begin5()
+//		2026/10/19 : move from begin() to here
+//****************************************************************************
+XBusError XBusServoEx::allocBuffers(void)
 {
 	int				bufferSize;						// channel data packet buffer size
 
@@ -109,6 +233,7 @@ XBusError XBusServoEx::begin(void)
 	if (sendBuffer == NULL)
 	{
 		free(chPacketBuffer);
+		chPacketBuffer = NULL;
 		return kXBusError_MemoryFull;
 	}
 
@@ -117,31 +242,62 @@ XBusError XBusServoEx::begin(void)
 	chPacketBuffer[kCHDataPacketLength]		= 0x00;
 	chPacketBuffer[kCHDataPacketKey]			= 0x00;
 	chPacketBuffer[kCHDataPacketType]			= 0x00;
-	
-	Serial.begin(kXBusBaudrate);
-	Serial.setTimeout(300);
 
 	return kXBusError_NoError;
 }
 
+
 //****************************************************************************
-//	XBusServoEx::end
+//	XBusServoEx::freeBuffers
 //		return :	none
 //		parameter :	none
 //
-//		This should be called when finishing XBus.
-//		2014/05/14 : add header by Sawa
-//		2014/10/09 : move memory free from destructor to here
+//		free all buffers.  common part of end() to end5()
+//		2026/10/19 : move from end() to here
 //****************************************************************************
-void XBusServoEx::end(void)
+void XBusServoEx::freeBuffers(void)
 {
-	Serial.end();
-	pinMode(this->dirPinNo, INPUT);
-
 	if (chPacketBuffer != NULL)
 		free(chPacketBuffer);
 	if (sendBuffer != NULL)
 		free(sendBuffer);
+	chPacketBuffer = NULL;
+	sendBuffer = NULL;
+	numOfServo = 0;
+
+	if (slewStep != NULL)
+		free(slewStep);
+	slewValue = NULL;
+	slewStep = NULL;
+	slewMaxStep = NULL;
+	slewMaxAccel = NULL;
+	slewing = 0;
+
+	if (sentValue != NULL)
+		free(sentValue);
+	sentValue = NULL;
+
+	if (rateDivider != NULL)
+		free(rateDivider);
+	rateDivider = NULL;
+
+	if (calTable != NULL)
+		free(calTable);
+	calTable = NULL;
+	calShift = NULL;
+
+	if (virtualValue != NULL)
+		free(virtualValue);
+	virtualValue = NULL;
+	virtualScale = NULL;
+	virtualOffset = NULL;
+	virtualSource = NULL;
+
+	if (servoStats != NULL)
+		free(servoStats);
+	servoStats = NULL;
+	builtSeq = servoSeq | 1;
+	builtSize = 0;
 }
 
 
@@ -156,18 +312,171 @@ void XBusServoEx::end(void)
 //****************************************************************************
 void XBusServoEx::sendChannelDataPacket(void)
 {
-	if (modifyServosNow)
-		return;
-	
-	if (numOfServo > 0)
+	int		sendSize;
+
+	sendSize = prepareChannelDataPacket();
+	if (sendSize > 0)
+		Serial.write(sendBuffer, sendSize);
+}
+
+
+//****************************************************************************
+//	XBusServoEx::prepareChannelDataPacket
+//		return :	size of the packet to send.  0 if there is nothing to send
+//		parameter :	none
+//
+//		common part of sendChannelDataPacket() to sendChannelDataPacket5().
+//		build the packet and record the frame timing for the admission control
+//		2026/10/19 : add for the admission control
+//		2026/10/19 : add trace recorder
+//****************************************************************************
+int XBusServoEx::prepareChannelDataPacket(void)
+{
+	int		sendSize = 0;
+
+	frameStartTime = micros();
+	frameCount++;
+
+	// the bus is turned to Rx while waiting the response of the command
+	if ((! commandBusy) && (numOfServo > 0))
+		sendSize = buildChannelDataPacket();
+
+	if ((traceRecorder != NULL) && (sendSize > 0))
+		traceRecorder->push(kXBusRecord_Frame, sendBuffer, sendSize, frameStartTime);
+
+	lastFrameSize = sendSize;
+	return sendSize;
+}
+
+
+//****************************************************************************
+//	XBusServoEx::getChannelFrameTime
+//		return :	uSec to send the channel data packet
+//		parameter :	servoNum	number of servos in the packet
+//
+//		2026/10/19 : add bus budget calculation
+//****************************************************************************
+unsigned long XBusServoEx::getChannelFrameTime(int servoNum)
+{
+	return (unsigned long)(kStartOffsetOfCHData + servoNum * kCHDataSize + 1) * kXBusByteTime;
+}
+
+
+//****************************************************************************
+//	XBusServoEx::getCommandTime
+//		return :	uSec to send the command and receive the response
+//		parameter :	channelID	channel ID of the XBus servo.  0 for TX only mode
+//					order		the order to send
+//
+//		2026/10/19 : add bus budget calculation
+//****************************************************************************
+unsigned long XBusServoEx::getCommandTime(char channelID, char order)
+{
+	return getCommandTime(channelID, order, getDataSize(order));
+}
+
+unsigned long XBusServoEx::getCommandTime(char channelID, char /* order */, char valueSize)
+{
+	unsigned long	packetTime;
+
+	packetTime = (unsigned long)(valueSize + 6) * kXBusByteTime;		// command, length, key, ID, order, CRC
+	if (channelID == 0)
+		return packetTime;												// no response in TX only mode
+
+	return packetTime + kXBusResponseGap + packetTime;
+}
+
+
+//****************************************************************************
+//	XBusServoEx::getBusLoad
+//		return :	bus load in percent of the frame interval
+//		parameter :	numOfCommand	number of commands (2 bytes order) in each frame
+//
+//		this may be over 100 when the servos and commands do not fit in the interval
+//		2026/10/19 : add bus budget calculation
+//****************************************************************************
+unsigned int XBusServoEx::getBusLoad(int numOfCommand)
+{
+	unsigned long	busTime;
+
+	busTime = getChannelFrameTime(numOfServo) + numOfCommand * getCommandTime(1, kXBusOrder_2_Neutral);
+	return (busTime * 100) / frameInterval;
+}
+
+
+//****************************************************************************
+//	XBusServoEx::setAdmissionControl
+//		return :	none
+//		parameter :	mode			kXBusAdmission_Off, kXBusAdmission_Reject or kXBusAdmission_Defer
+//					intervalUSec	interval of sendChannelDataPacket in uSec.
+//									0 for kXBusInterval
+//
+//		check that each command finishes before the next channel data packet.
+//		kXBusAdmission_Reject returns kXBusError_BusBusy if it does not fit,
+//		kXBusAdmission_Defer waits for the next channel data packet and sends it after that
+//		2026/10/19 : add admission control
+//****************************************************************************
+void XBusServoEx::setAdmissionControl(XBusAdmission mode, unsigned long intervalUSec)
+{
+	admissionMode = mode;
+	if (intervalUSec == 0)
+		intervalUSec = kXBusInterval * 1000L;
+	frameInterval = intervalUSec;
+}
+
+
+//****************************************************************************
+//	XBusServoEx::waitCommandSlot
+//		return :	error code
+//		parameter :	channelID	channel ID of the XBus servo
+//					valueSize	value size of the command
+//
+//		check the time to the next channel data packet by the admission control.
+//		it does nothing until the first channel data packet is sent
+//		2026/10/19 : add admission control
+//****************************************************************************
+XBusError XBusServoEx::waitCommandSlot(char channelID, char valueSize)
+{
+	unsigned long	commandTime;
+	char			deferred = 0;
+
+	if ((admissionMode == kXBusAdmission_Off) || (frameCount == 0))
+		return kXBusError_NoError;
+
+	commandTime = getCommandTime(channelID, 0, valueSize);
+	while (1)
 	{
-		if (dirty)
+		unsigned long	startTime;
+		unsigned long	busyTime;
+		unsigned long	elapsed;
+		unsigned int	count;
+		unsigned long	waitStart;
+
+		noInterrupts();
+		startTime = frameStartTime;
+		busyTime = (unsigned long)lastFrameSize * kXBusByteTime;
+		count = frameCount;
+		interrupts();
+
+		// the command waits in the UART until the channel data packet is sent
+		elapsed = micros() - startTime;
+		if (elapsed < busyTime)
+			elapsed = busyTime;
+		if (elapsed + commandTime <= frameInterval)
+			return kXBusError_NoError;
+
+		if ((admissionMode == kXBusAdmission_Reject) || deferred)
+			return kXBusError_BusBusy;
+
+		// wait for the next channel data packet
+		waitStart = micros();
+		while (frameCount == count)
 		{
-			memcpy(sendBuffer, chPacketBuffer, chPacketBuffer[kCHDataPacketLength] + 3);
-			dirty = 0;
+			if ((micros() - waitStart) > frameInterval * 2)
+				return kXBusError_BusBusy;						// channel data packet is stopped
+			yield();
 		}
-		
-		Serial.write(sendBuffer, sendBuffer[kCHDataPacketLength] + 3);
+		deferred = 1;
 	}
 }
 
@@ -184,274 +493,1726 @@ void XBusServoEx::sendChannelDataPacket(void)
 //		This should NOT be called on the timer handler like MsTimer2 when you
 //		setup the XBus servo.
 //		2014/05/14 : add header by Sawa
+//		2026/10/19 : use the streaming parser via startCommand / pollCommand
+//		2026/10/19 : add retry
+//		2026/10/19 : retry also on the echo error
 //****************************************************************************
 XBusError XBusServoEx::sendCommandDataPacket(char command, char channelID, char order, int* value, char valueSize)
 {
-	int					sendSize;
-	int					recieveSize;
-	
-	// setup command
-	sendBuffer[kCmdDataPacketCommand] = command;
-	sendBuffer[kCmdDataPacketLength] = valueSize + 3;
-	sendBuffer[kCmdDataPacketKey] = 0x00;
-	sendBuffer[kCmdDataPacketCH_ID] = channelID;
-	sendBuffer[kCmdDataPacketOrder] = order;
-	if (valueSize == 1)						// 1 byte value
-	{
-		sendBuffer[kCmdDataPacketData1] = *value & 0x00FF;
-		sendBuffer[kCmdDataPacketData2] = crc8(sendBuffer, sendBuffer[kCHDataPacketLength] + 2);
-	}
-	else
+	XBusError			result;
+	unsigned char		attempt;
+
+	for (attempt = 1; ; attempt++)
 	{
-		sendBuffer[kCmdDataPacketData1] = (*value >> 8) & 0x00FF;
-		sendBuffer[kCmdDataPacketData2] = *value & 0x00FF;		
-		sendBuffer[kCmdDataPacketCRC] = crc8(sendBuffer, sendBuffer[kCHDataPacketLength] + 2);
+		result = startCommand(command, channelID, order, *value, valueSize, 0);
+		if (result != kXBusError_NoError)
+			return result;
+
+		do
+			result = pollCommand(value);
+		while (result == kXBusError_Pending);
+
+		if (((result != kXBusError_CRCError) && (result != kXBusError_TimeOut) && (result != kXBusError_EchoError))
+				|| (attempt >= retryMaxAttempts))
+			return result;
+
+		// retry after the channel data packets so that it does not collide with them
+		countServoStats(channelID, kXBusStats_Retry);
+		waitFrames(retryBackoffFrames);
 	}
-	
-	// to recover channel data packet when you call sendChannelDataPacket after this
-	dirty = 1;
+}
 
-	// send command
-	sendSize = sendBuffer[kCmdDataPacketLength] + 3;
-	while(Serial.read() >= 0)
-		;																				// flush the receive buffer
-	Serial.write(sendBuffer, sendSize);
-	Serial.flush();														// wait to send all bytes
 
-	// change bus direction to Rx mode
-	if (dirPinNo >= 0)
-		digitalWrite(dirPinNo, HIGH);
-	
-	if (channelID != 0)
-	{
-		// dummy read for sent packet
-		recieveSize = Serial.readBytes((char*)sendBuffer, sendSize);
-		if (recieveSize == 0)
-		{
-		// change bus direction to Tx mode
-			if (dirPinNo >= 0)
-				digitalWrite(dirPinNo, LOW);
-			return kXBusError_TimeOut;
-		}
+//****************************************************************************
+//	XBusServoEx::setRetryPolicy
+//		return :	none
+//		parameter :	maxAttempts		max number of sending the command.  1 for no retry
+//					backoffFrames	number of channel data packets to wait before retry
+//
+//		retry the command on kXBusError_CRCError, kXBusError_TimeOut and
+//		kXBusError_EchoError (collision on the bus).
+//		the retry waits for backoffFrames channel data packets and is sent
+//		just after the channel data packet.  (the time slot is checked by the
+//		admission control if it is on)
+//		2026/10/19 : add retry
+//		2026/10/19 : retry also on the echo error
+//****************************************************************************
+void XBusServoEx::setRetryPolicy(unsigned char maxAttempts, unsigned char backoffFrames)
+{
+	if (maxAttempts == 0)
+		maxAttempts = 1;
+	retryMaxAttempts = maxAttempts;
+	retryBackoffFrames = backoffFrames;
+}
 
-		// read packet
-		recieveSize = Serial.readBytes((char*)sendBuffer, 2);
-		if (recieveSize == 0)
-		{
-		// change bus direction to Tx mode
-			if (dirPinNo >= 0)
-				digitalWrite(dirPinNo, LOW);
-			return kXBusError_TimeOut;
-		}
-		
-		Serial.readBytes((char*)&(sendBuffer[kCmdDataPacketKey]), sendBuffer[kCHDataPacketLength] + 1);
-		if (recieveSize == 0)
-		{
-		// change bus direction to Tx mode
-			if (dirPinNo >= 0)
-				digitalWrite(dirPinNo, LOW);
-			return kXBusError_TimeOut;
-		}
 
-		// change bus direction to Tx mode
-		if (dirPinNo >= 0)
-			digitalWrite(dirPinNo, LOW);
+//****************************************************************************
+//	XBusServoEx::setCommandTimeOut / getCommandTimeOut
+//		return :	none / timeout in uSec
+//		parameter :	timeOutUSec		uSec from sending the command to the timeout.
+//									0 for the response window (default)
+//
+//		the channel data packets are stopped until the response or the timeout,
+//		so by default the command waits only for the response window: the time
+//		of the command and the response (getCommandTime), kXBusEchoMargin and
+//		kXBusResponseMargin.  it is a few mSec, and the command to the servo
+//		not connected does not stop the other servos for long
+//		2026/10/19 : add
+//		2026/10/19 : 0 for the response window instead of 300mSec
+//****************************************************************************
+void XBusServoEx::setCommandTimeOut(unsigned long timeOutUSec)
+{
+	cmdTimeOut = timeOutUSec;
+}
 
-		// check CRC
-		if (crc8(sendBuffer, sendBuffer[kCHDataPacketLength] + 3) != 0)
-			return kXBusError_CRCError;
+unsigned long XBusServoEx::getCommandTimeOut(void)
+{
+	return cmdTimeOut;
+}
 
-		// check unsupported
-		if (sendBuffer[kCmdDataPacketOrder] == kXBusOrder_1_Unsupported)
-			return kXBusError_Unsupported;
 
-		// send bcak the value
-		if (valueSize == 1)						// 1 byte value
-		{
-			*value = sendBuffer[kCmdDataPacketData1];
-			if (*value & 0x0080)
-				*value |= 0xFF00;
-		}
-		else
-		{
-			*value = sendBuffer[kCmdDataPacketData1];
-			*value <<= 8;
-			*value |= sendBuffer[kCmdDataPacketData2];		
-		}
+//****************************************************************************
+//	XBusServoEx::waitFrames
+//		return :	none
+//		parameter :	frames		number of channel data packets to wait
+//
+//		wait until the channel data packets are sent.  if they are not sent
+//		by the timer, it waits for the time of the frames
+//		2026/10/19 : add retry
+//		2026/10/19 : wait until the last packet is out of the wire
+//****************************************************************************
+void XBusServoEx::waitFrames(unsigned char frames)
+{
+	unsigned int		count;
+	unsigned long		waitStart;
 
-		return kXBusError_NoError;
-	}
-	else
+	if (frames == 0)
+		return;
+
+	noInterrupts();
+	count = frameCount;
+	interrupts();
+
+	waitStart = micros();
+	while ((micros() - waitStart) < frameInterval * (frames + 1))
 	{
-		// change bus direction to Tx mode
-		if (dirPinNo >= 0)
-			digitalWrite(dirPinNo, LOW);
-		return kXBusError_NoError;
+		unsigned int	current;
+
+		noInterrupts();
+		current = frameCount;
+		interrupts();
+		if ((unsigned int)(current - count) >= frames)
+		{
+			waitFrameSent();
+			return;
+		}
+		yield();
 	}
 }
 
 
+//****************************************************************************
+//	XBusServoEx::waitFrameSent
+//		return :	none
+//		parameter :	none
+//
+//		wait until the last channel data packet goes out of the wire and
+//		the gap after it.  it returns at once if the packet is already sent
+//		2026/10/19 : add
+//****************************************************************************
+void XBusServoEx::waitFrameSent(void)
+{
+	unsigned long		startTime;
+	unsigned long		busyTime;
+
+	noInterrupts();
+	startTime = frameStartTime;
+	busyTime = (unsigned long)lastFrameSize * kXBusByteTime;
+	interrupts();
+
+	if (busyTime == 0)
+		return;
+
+	busyTime += kXBusResponseGap;
+	while ((micros() - startTime) < busyTime)
+		yield();
+}
+
 
 //****************************************************************************
-//	XBusServoEx::addServo
+//	XBusServoEx::enableServoStats
 //		return :	error code
-//		parameter :	channelID	channel ID of the XBus servo that you want to use
-//					initValue	initial value of this XBus servo
-//								use kXBusServoExNeutral for center of the XBus servo
+//		parameter :	none
 //
-//		add new servo to the buffer on this library
-//		2014/05/14 : add header by Sawa
+//		start to count the errors of the commands for each servo.
+//		the buffer is allocated at the first call
+//		2026/10/19 : add servo statistics
 //****************************************************************************
-XBusError XBusServoEx::addServo(char channelID, unsigned int initValue)
+XBusError XBusServoEx::enableServoStats(void)
 {
-	int			dataOffset;
-
-	// max check
-	if (numOfServo >= maxServo)
-		return kXBusError_ServoNumOverflow;
-	
-	// convert to servo ID
-	channelID &= 0x3F;
-	
-	// scan servo ID that is already added
-	if (numOfServo > 0)
+	if (servoStats == NULL)
 	{
-		int		servoNo;
-
-		for (servoNo = 0; servoNo < numOfServo; servoNo++)
-			if (chPacketBuffer[kStartOffsetOfCHData + kCHDataSize * servoNo] == channelID)
-				return kXBusError_AddWithSameID;							// found same servo ID
+		// add 1 for the servos not added by addServo
+		servoStats = (XBusServoStats*)malloc((maxServo + 1) * sizeof(XBusServoStats));
+		if (servoStats == NULL)
+			return kXBusError_MemoryFull;
 	}
-	
-	// atomic flag on
-	modifyServosNow = 1;
-	
-	// add new servo
-	dataOffset = kStartOffsetOfCHData + kCHDataSize * numOfServo;
-	numOfServo++;
-	chPacketBuffer[kCHDataPacketLength] = numOfServo * kCHDataSize + 2;		// add 2 for key and type
-	
-	chPacketBuffer[dataOffset] = channelID;
-	chPacketBuffer[dataOffset + 1] = 0x00;
-	chPacketBuffer[dataOffset + 2] = (initValue >> 8) & 0x00FF;
-	chPacketBuffer[dataOffset + 3] = initValue & 0x00FF;
-	
-	// calc CRC
-	chPacketBuffer[dataOffset + 4] = crc8(chPacketBuffer, chPacketBuffer[kCHDataPacketLength] + 2);
-	dirty = 1;
+	memset(servoStats, 0, (maxServo + 1) * sizeof(XBusServoStats));
 
-	// atomic flag off
-	modifyServosNow = 0;
-	
 	return kXBusError_NoError;
 }
 
 
 //****************************************************************************
-//	XBusServoEx::removeServo
+//	XBusServoEx::getServoStats
 //		return :	error code
-//		parameter :	channelID	channel ID of the XBus servo that you want to remove
+//		parameter :	channelID	channel ID of the XBus servo.
+//								the servo not added by addServo is counted together
+//					stats		buffer to get the statistics
 //
-//		remove the servo from the buffer on this library
-//		2014/05/14 : add header by Sawa
+//		2026/10/19 : add servo statistics
 //****************************************************************************
-XBusError XBusServoEx::removeServo(char channelID)
+XBusError XBusServoEx::getServoStats(char channelID, XBusServoStats* stats)
 {
-	int			dataOffset;
+	int			servoNo;
 
-	// min check
-	if (numOfServo == 0)
-		return kXBusError_ServoNumIsZero;
+	if (servoStats == NULL)
+		return kXBusError_Unsupported;
 
-	// convert to servo ID
-	channelID &= 0x3F;
-	
-	// scan servo ID that is already added
-	if (numOfServo > 0)
-	{
-		int		servoNo;
+	servoNo = findServo(channelID);
+	if (servoNo < 0)
+		servoNo = maxServo;
+	*stats = servoStats[servoNo];
 
-		for (servoNo = 0; servoNo < numOfServo; servoNo++)
-			if (chPacketBuffer[kStartOffsetOfCHData + kCHDataSize * servoNo] == channelID)
-			{
-				// atomic flag on
-				modifyServosNow = 1;
+	return kXBusError_NoError;
+}
+
+
+//****************************************************************************
+//	XBusServoEx::setTraceRecorder
+//		return :	none
+//		parameter :	recorder	ring buffer to record the packets.  NULL to stop
+//
+//		record the channel data packets, the commands, the responses and the
+//		errors of the commands with micros().  the frames are recorded by the
+//		timer handler and the commands only while commandBusy stops the frames,
+//		so the ring buffer has only one writer at a time.
+//		read the records with recorder->dump() out of the timer handler
+//		2026/10/19 : add trace recorder
+//****************************************************************************
+void XBusServoEx::setTraceRecorder(XBusRecordRing* recorder)
+{
+	traceRecorder = recorder;
+}
+
+
+//****************************************************************************
+//	XBusServoEx::countServoStats
+//		return :	none
+//		parameter :	channelID	channel ID of the XBus servo
+//					item		the item to count up
+//
+//		2026/10/19 : add servo statistics
+//****************************************************************************
+void XBusServoEx::countServoStats(char channelID, XBusStatsItem item)
+{
+	XBusServoStats*	stats;
+	int				servoNo;
+
+	if (servoStats == NULL)
+		return;
+
+	servoNo = findServo(channelID);
+	if (servoNo < 0)
+		servoNo = maxServo;
+	stats = &servoStats[servoNo];
+
+	switch (item)
+	{
+		case kXBusStats_CRCError:
+			stats->crcErrors++;
+			break;
+		case kXBusStats_TimeOut:
+			stats->timeouts++;
+			break;
+		case kXBusStats_Retry:
+			stats->retries++;
+			break;
+		case kXBusStats_EchoError:
+			stats->echoErrors++;
+			break;
+		case kXBusStats_Command:
+			stats->commands++;
+			break;
+	}
+}
+
+
+//****************************************************************************
+//	XBusServoEx::countLatency
+//		return :	none
+//		parameter :	channelID	channel ID of the XBus servo
+//					latency		uSec from sending the command to the end of the response
+//
+//		2026/10/19 : add latency histogram
+//****************************************************************************
+void XBusServoEx::countLatency(char channelID, unsigned long latency)
+{
+	int				servoNo;
+	int				bin;
+
+	if (servoStats == NULL)
+		return;
+
+	servoNo = findServo(channelID);
+	if (servoNo < 0)
+		servoNo = maxServo;
+
+	latency >>= 10;												// about mSec
+	for (bin = 0; (latency != 0) && (bin < kXBusLatencyBins - 1); bin++)
+		latency >>= 1;
+	servoStats[servoNo].latency[bin]++;
+}
+
+
+//****************************************************************************
+//	XBusServoEx::setTxUSART
+//		return :	none
+//		parameter :	usartNo		USART number of the port selected by begin() to begin5()
+//
+//		select the USART whose TX complete interrupt turns the bus to Rx.
+//		-1 (or no TX complete interrupt) waits with flush() instead
+//		2026/10/19 : turn the bus by the TX complete interrupt
+//		2026/10/19 : usartNo is not used without the TX complete interrupt
+//****************************************************************************
+void XBusServoEx::setTxUSART(int usartNo)
+{
+	txUSARTNo = -1;
+	txUCSRB = NULL;
+
+#if defined(XBUS_USE_TX_COMPLETE_ISR)
+	if (dirPort == NULL)
+		return;
+
+	switch (usartNo)
+	{
+#if defined(USART_TX_vect) || defined(USART0_TX_vect)
+		case 0:
+			txUCSRB = &UCSR0B;
+			txcieBit = TXCIE0;
+			break;
+#endif
+#if defined(USART1_TX_vect)
+		case 1:
+			txUCSRB = &UCSR1B;
+			txcieBit = TXCIE1;
+			break;
+#endif
+#if defined(USART2_TX_vect)
+		case 2:
+			txUCSRB = &UCSR2B;
+			txcieBit = TXCIE2;
+			break;
+#endif
+#if defined(USART3_TX_vect)
+		case 3:
+			txUCSRB = &UCSR3B;
+			txcieBit = TXCIE3;
+			break;
+#endif
+		default:
+			return;
+	}
+
+	txUSARTNo = usartNo;
+	s_txDirPort[usartNo] = dirPort;
+	s_txDirMask[usartNo] = dirMask;
+#else
+	(void)usartNo;
+#endif
+}
+
+
+//****************************************************************************
+//	XBusServoEx::setRxDirection / setTxDirection
+//		return :	none
+//		parameter :	none
+//
+//		turn the bus direction.  on AVR the port register is written directly.
+//		setRxDirection is called just after the command is written to the port.
+//		with the TX complete interrupt it returns at once and the interrupt
+//		turns the bus just after the stop bit of the last byte.  (HardwareSerial
+//		clears TXC on every byte, so it is not set before the last byte ends.)
+//		otherwise it waits with flush()
+//		2026/10/19 : turn the bus by the TX complete interrupt
+//****************************************************************************
+void XBusServoEx::setRxDirection(void)
+{
+#if defined(XBUS_USE_TX_COMPLETE_ISR)
+	if (txUCSRB != NULL)
+	{
+		*txUCSRB |= (1 << txcieBit);
+		return;
+	}
+#endif
+
+	xbusSerial->flush();												// wait to send all bytes
+
+#if defined(__AVR__)
+	if (dirPort != NULL)
+	{
+		uint8_t		oldSREG = SREG;
+
+		noInterrupts();
+		*dirPort |= dirMask;
+		SREG = oldSREG;
+		return;
+	}
+#endif
+	digitalWrite(dirPinNo, HIGH);
+}
+
+void XBusServoEx::setTxDirection(void)
+{
+#if defined(__AVR__)
+	if (dirPort != NULL)
+	{
+		uint8_t		oldSREG = SREG;
+
+		noInterrupts();
+#if defined(XBUS_USE_TX_COMPLETE_ISR)
+		if (txUCSRB != NULL)
+			*txUCSRB &= ~(1 << txcieBit);							// in case the command is aborted while sending
+#endif
+		*dirPort &= ~dirMask;
+		SREG = oldSREG;
+		return;
+	}
+#endif
+	digitalWrite(dirPinNo, LOW);
+}
+
+
+//****************************************************************************
+//	XBusServoEx::startCommand
+//		return :		error code
+//		parameter :	command		The commnad that you want to send
+//					channelID	The channel ID of the XBus servo that you want to set up
+//					order		The order that you want to set up
+//					value		The value that you want to set
+//					valueSize	The value size.  1 byte(char) or 2 byte(int)
+//					timeOutUSec	uSec from sending the command to the timeout.
+//								0 for setCommandTimeOut
+//
+//		send the command packet and return without waiting for the response.
+//		call pollCommand until it returns other than kXBusError_Pending
+//		2026/10/19 : split from sendCommandDataPacket
+//		2026/10/19 : add trace recorder
+//		2026/10/19 : turn the bus by the TX complete interrupt
+//		2026/10/19 : wait for the channel data packet being sent
+//		2026/10/19 : wait for the response only within the response window
+//		2026/10/19 : add timeout of each command
+//****************************************************************************
+XBusError XBusServoEx::startCommand(char command, char channelID, char order, int value, char valueSize, unsigned long timeOutUSec)
+{
+	int					sendSize;
+	XBusError			result;
+
+	if (xbusSerial == NULL)
+		return kXBusError_Unsupported;							// begin() is not called
+	if (commandBusy)
+		return kXBusError_BusBusy;
+
+	// wait for the time slot between the channel data packets
+	result = waitCommandSlot(channelID, valueSize);
+	if (result != kXBusError_NoError)
+		return result;
+
+	// setup command
+	cmdBuffer[kCmdDataPacketCommand] = command;
+	cmdBuffer[kCmdDataPacketLength] = valueSize + 3;
+	cmdBuffer[kCmdDataPacketKey] = 0x00;
+	cmdBuffer[kCmdDataPacketCH_ID] = channelID;
+	cmdBuffer[kCmdDataPacketOrder] = order;
+	if (valueSize == 1)						// 1 byte value
+	{
+		cmdBuffer[kCmdDataPacketData1] = value & 0x00FF;
+		cmdBuffer[kCmdDataPacketData2] = crc8(cmdBuffer, cmdBuffer[kCmdDataPacketLength] + 2);
+	}
+	else
+	{
+		cmdBuffer[kCmdDataPacketData1] = (value >> 8) & 0x00FF;
+		cmdBuffer[kCmdDataPacketData2] = value & 0x00FF;
+		cmdBuffer[kCmdDataPacketCRC] = crc8(cmdBuffer, cmdBuffer[kCmdDataPacketLength] + 2);
+	}
+
+	// stop the channel data packet until the response.  not longer than the
+	// response window
+	noInterrupts();
+	commandBusy = 1;
+	interrupts();
+	cmdValueSize = valueSize;
+	cmdWaitTime = (timeOutUSec != 0) ? timeOutUSec
+					: (cmdTimeOut != 0) ? cmdTimeOut
+					: getCommandTime(channelID, order, valueSize) + kXBusEchoMargin + kXBusResponseMargin;
+	cmdResult = kXBusError_Pending;
+
+	// the channel data packet being sent and its echo must be over before
+	// the receive buffer is flushed, or the echo is taken for the command's
+	waitFrameSent();
+
+	// send command
+	sendSize = cmdBuffer[kCmdDataPacketLength] + 3;
+	while(xbusSerial->read() >= 0)
+		;																				// flush the receive buffer
+	cmdSendTime = micros();
+	if (traceRecorder != NULL)
+		traceRecorder->push(kXBusRecord_Command, cmdBuffer, sendSize, cmdSendTime);
+	xbusSerial->write(cmdBuffer, sendSize);
+
+	if (channelID == 0)
+	{
+		// no response in TX only mode
+		xbusSerial->flush();											// wait to send all bytes
+		cmdResult = kXBusError_NoError;
+		commandBusy = 0;
+		return kXBusError_NoError;
+	}
+
+	// change bus direction to Rx mode after the last byte
+	if (dirPinNo >= 0)
+		setRxDirection();
+
+	cmdEchoRemain = sendSize;
+	rxParser.reset();
+	cmdCRCErrors = rxParser.crcErrorCount();
+
+	return kXBusError_NoError;
+}
+
+
+//****************************************************************************
+//	XBusServoEx::pollCommand
+//		return :		error code.  kXBusError_Pending while waiting the response
+//		parameter :	value		the value returned from the servo
+//
+//		read the bytes received and check the response of the command sent by
+//		startCommand.  it does not block.
+//		2026/10/19 : split from sendCommandDataPacket
+//		2026/10/19 : add trace recorder
+//		2026/10/19 : check the echo
+//		2026/10/19 : add latency histogram
+//		2026/10/19 : timeout in uSec set by setCommandTimeOut
+//		2026/10/19 : timeout at the end of the response window
+//****************************************************************************
+XBusError XBusServoEx::pollCommand(int* value)
+{
+	int			data;
+	uint8_t*	packet;
+
+	if (! commandBusy)
+		return cmdResult;
+
+	while ((data = xbusSerial->read()) >= 0)
+	{
+		// check the echo of the packet sent.  the different byte is the
+		// collision on the bus or the wiring fault
+		if (cmdEchoRemain > 0)
+		{
+			uint8_t		sent = cmdBuffer[cmdBuffer[kCmdDataPacketLength] + 3 - cmdEchoRemain];
+
+			if ((uint8_t)data != sent)
+				return finishCommand(kXBusError_EchoError);
+			cmdEchoRemain--;
+			continue;
+		}
+
+		if (rxParser.feed(data))
+			break;
+	}
+
+	// the echo does not come.  Rx is not connected to the bus
+	if ((cmdEchoRemain > 0)
+			&& ((micros() - cmdSendTime) > (unsigned long)(cmdBuffer[kCmdDataPacketLength] + 3) * kXBusByteTime + kXBusEchoMargin))
+		return finishCommand(kXBusError_EchoError);
+
+	if (rxParser.packetSize() == 0)
+	{
+		// broken response.  no more bytes will come for this command
+		if ((rxParser.crcErrorCount() != cmdCRCErrors) && (rxParser.pendingSize() == 0))
+			return finishCommand(kXBusError_CRCError);
+
+		if ((micros() - cmdSendTime) < cmdWaitTime)
+			return kXBusError_Pending;
+
+		return finishCommand((rxParser.crcErrorCount() != cmdCRCErrors) ? kXBusError_CRCError : kXBusError_TimeOut);
+	}
+
+	packet = rxParser.packet();
+	countLatency(cmdBuffer[kCmdDataPacketCH_ID], micros() - cmdSendTime);
+	if (traceRecorder != NULL)
+		traceRecorder->push(kXBusRecord_Response, packet, rxParser.packetSize(),
+							micros() - (unsigned long)rxParser.packetSize() * kXBusByteTime);
+
+	// check unsupported
+	if (packet[kCmdDataPacketOrder] == kXBusOrder_1_Unsupported)
+		return finishCommand(kXBusError_Unsupported);
+
+	// send bcak the value
+	if (cmdValueSize == 1)						// 1 byte value
+	{
+		*value = packet[kCmdDataPacketData1];
+		if (*value & 0x0080)
+			*value |= 0xFF00;
+	}
+	else
+	{
+		*value = packet[kCmdDataPacketData1];
+		*value <<= 8;
+		*value |= packet[kCmdDataPacketData2];
+	}
+
+	return finishCommand(kXBusError_NoError);
+}
+
+
+//****************************************************************************
+//	XBusServoEx::finishCommand
+//		return :		result
+//		parameter :	result		result of the command
+//
+//		release the bus after the command
+//		2026/10/19 : split from sendCommandDataPacket
+//		2026/10/19 : add servo statistics
+//		2026/10/19 : add trace recorder
+//		2026/10/19 : use the cached port register
+//****************************************************************************
+XBusError XBusServoEx::finishCommand(XBusError result)
+{
+	// change bus direction to Tx mode
+	if (dirPinNo >= 0)
+		setTxDirection();
+
+	// record while commandBusy keeps the channel data packet from the recorder
+	if ((traceRecorder != NULL) && (result != kXBusError_NoError))
+	{
+		uint8_t		error = result;
+
+		traceRecorder->push(kXBusRecord_Error, &error, 1, micros());
+	}
+
+	cmdResult = result;
+	commandBusy = 0;
+
+	countServoStats(cmdBuffer[kCmdDataPacketCH_ID], kXBusStats_Command);
+	if (result == kXBusError_CRCError)
+		countServoStats(cmdBuffer[kCmdDataPacketCH_ID], kXBusStats_CRCError);
+	else if (result == kXBusError_TimeOut)
+		countServoStats(cmdBuffer[kCmdDataPacketCH_ID], kXBusStats_TimeOut);
+	else if (result == kXBusError_EchoError)
+		countServoStats(cmdBuffer[kCmdDataPacketCH_ID], kXBusStats_EchoError);
+
+	return result;
+}
+
+
+//****************************************************************************
+//	XBusServoEx::startSetCommand / startGetCommand
+//		return :	error code
+//		parameter :	channelID	channel ID of the XBus servo
+//					order		the order that you want
+//					value		the value that you want to set
+//					timeOutUSec	uSec from sending the command to the timeout of
+//								this command only.  0 for setCommandTimeOut
+//
+//		send set / get command without waiting for the response.
+//		call pollCommand until it returns other than kXBusError_Pending
+//		2026/10/19 : add
+//		2026/10/19 : add timeout of each command
+//****************************************************************************
+XBusError XBusServoEx::startSetCommand(char channelID, char order, int value, unsigned long timeOutUSec)
+{
+	return startCommand(kXBusCmd_Set, channelID, order, value, getDataSize(order), timeOutUSec);
+}
+
+XBusError XBusServoEx::startGetCommand(char channelID, char order, unsigned long timeOutUSec)
+{
+	return startCommand(kXBusCmd_Get, channelID, order, 0, getDataSize(order), timeOutUSec);
+}
+
+
+
+//****************************************************************************
+//	XBusServoEx::addServo
+//		return :	error code
+//		parameter :	channelID	channel ID of the XBus servo that you want to use
+//					initValue	initial value of this XBus servo
+//								use kXBusServoExNeutral for center of the XBus servo
+//
+//		add new servo to the buffer on this library
+//		2014/05/14 : add header by Sawa
+//		2026/10/19 : replace modifyServosNow with the sequence counter
+//****************************************************************************
+XBusError XBusServoEx::addServo(char channelID, unsigned int initValue)
+{
+	int			dataOffset;
+
+	// max check
+	if (numOfServo >= maxServo)
+		return kXBusError_ServoNumOverflow;
+	
+	// convert to servo ID
+	channelID &= 0x3F;
+	
+	// scan servo ID that is already added
+	if (numOfServo > 0)
+	{
+		int		servoNo;
+
+		for (servoNo = 0; servoNo < numOfServo; servoNo++)
+			if (chPacketBuffer[kStartOffsetOfCHData + kCHDataSize * servoNo] == channelID)
+				return kXBusError_AddWithSameID;							// found same servo ID
+	}
+	
+	beginModify();
+	
+	// add new servo
+	dataOffset = kStartOffsetOfCHData + kCHDataSize * numOfServo;
+	numOfServo++;
+	chPacketBuffer[kCHDataPacketLength] = numOfServo * kCHDataSize + 2;		// add 2 for key and type
+	
+	chPacketBuffer[dataOffset] = channelID;
+	chPacketBuffer[dataOffset + 1] = 0x00;
+	chPacketBuffer[dataOffset + 2] = (initValue >> 8) & 0x00FF;
+	chPacketBuffer[dataOffset + 3] = initValue & 0x00FF;
+	initSlotData(numOfServo - 1, initValue);
+
+	endModify();
+	
+	return kXBusError_NoError;
+}
+
+
+//****************************************************************************
+//	XBusServoEx::removeServo
+//		return :	error code
+//		parameter :	channelID	channel ID of the XBus servo that you want to remove
+//
+//		remove the servo from the buffer on this library
+//		2014/05/14 : add header by Sawa
+//		2026/10/19 : replace modifyServosNow with the sequence counter
+//****************************************************************************
+XBusError XBusServoEx::removeServo(char channelID)
+{
+	int			dataOffset;
+
+	// min check
+	if (numOfServo == 0)
+		return kXBusError_ServoNumIsZero;
+
+	// convert to servo ID
+	channelID &= 0x3F;
+	
+	// scan servo ID that is already added
+	if (numOfServo > 0)
+	{
+		int		servoNo;
+
+		for (servoNo = 0; servoNo < numOfServo; servoNo++)
+			if (chPacketBuffer[kStartOffsetOfCHData + kCHDataSize * servoNo] == channelID)
+			{
+				beginModify();
 				
 				// copy data after that
 				if (servoNo < (numOfServo - 1))
-					memcpy(&(chPacketBuffer[kStartOffsetOfCHData + kCHDataSize * servoNo]),
+					memmove(&(chPacketBuffer[kStartOffsetOfCHData + kCHDataSize * servoNo]),
 							&(chPacketBuffer[kStartOffsetOfCHData + kCHDataSize * (servoNo + 1)]),
 							kCHDataSize * (numOfServo - servoNo - 1));
+				removeSlotData(servoNo);
 				
 				// update packet size
 				numOfServo--;
 				chPacketBuffer[kCHDataPacketLength] = numOfServo * kCHDataSize + 2;		// add 2 for key and type
 
-				// calc CRC
-				chPacketBuffer[kStartOffsetOfCHData + kCHDataSize * numOfServo]
-						= crc8(chPacketBuffer, chPacketBuffer[kCHDataPacketLength] + 2);
-				dirty = 1;
+				endModify();
+
+				return kXBusError_NoError;
+			}
+	}
+	
+	return kXBusError_IDNotFound;
+}
+
+
+//****************************************************************************
+//	XBusServoEx::setServo
+//		return :		error code
+//		parameter :	channelID	channel ID of the XBus servo that you want to set
+//					value		value of this XBus servo
+//								use kXBusServoExNeutral for center of the XBus servo
+//
+//		set new value to the servo
+//		2014/05/14 : add header by Sawa
+//		2026/10/19 : replace modifyServosNow with the sequence counter
+//****************************************************************************
+XBusError XBusServoEx::setServo(char channelID, unsigned int value)
+{
+	int			dataOffset;
+
+	// convert to servo ID
+	channelID &= 0x3F;
+	
+	// scan servo ID that is already added
+	if (numOfServo > 0)
+	{
+		int		servoNo;
+
+		for (servoNo = 0; servoNo < numOfServo; servoNo++)
+		{
+			dataOffset = kStartOffsetOfCHData + kCHDataSize * servoNo;
+			
+			if (chPacketBuffer[dataOffset] == channelID)
+			{
+				beginModify();
+				
+				// set value
+				chPacketBuffer[dataOffset + 2] = (value >> 8) & 0x00FF;
+				chPacketBuffer[dataOffset + 3] = value & 0x00FF;
+
+				endModify();
+				
+				return kXBusError_NoError;
+			}
+		}
+	}
+	
+	return kXBusError_IDNotFound;
+}
+
+
+//****************************************************************************
+//	XBusServoEx::setServoByIndex
+//		return :		error code
+//		parameter :	servoNo		index of the servo in the order it was added (0 origin)
+//					value		value of this XBus servo
+//
+//		set new value to the servo without the channel ID lookup.
+//		this is for the streaming sources like the motion player
+//		2026/10/19 : add for the motion player
+//		2026/10/19 : replace modifyServosNow with the sequence counter
+//****************************************************************************
+XBusError XBusServoEx::setServoByIndex(int servoNo, unsigned int value)
+{
+	int			dataOffset;
+
+	if ((servoNo < 0) || (servoNo >= numOfServo))
+		return kXBusError_IDNotFound;
+
+	dataOffset = kStartOffsetOfCHData + kCHDataSize * servoNo;
+
+	beginModify();
+
+	// set value
+	chPacketBuffer[dataOffset + 2] = (value >> 8) & 0x00FF;
+	chPacketBuffer[dataOffset + 3] = value & 0x00FF;
+
+	endModify();
+
+	return kXBusError_NoError;
+}
+
+
+//****************************************************************************
+//	XBusServoEx::setServosByIndex
+//		return :		error code
+//		parameter :	servoNo		index of the first servo (0 origin)
+//					count		number of the servos
+//					values		values of the servos.  2 bytes each in big endian
+//								(the byte order of the channel data packet)
+//
+//		set the values of the servos in a row in one update of the sequence
+//		counter, so that they are sent in the same frame.  for the pose bridge
+//		2026/10/19 : add for the pose bridge
+//****************************************************************************
+XBusError XBusServoEx::setServosByIndex(int servoNo, int count, const uint8_t* values)
+{
+	uint8_t*	slot;
+
+	if ((servoNo < 0) || (count < 0) || (servoNo + count > numOfServo))
+		return kXBusError_IDNotFound;
+
+	slot = chPacketBuffer + kStartOffsetOfCHData + kCHDataSize * servoNo + 2;
+
+	beginModify();
+
+	while (count-- > 0)
+	{
+		slot[0] = *values++;
+		slot[1] = *values++;
+		slot += kCHDataSize;
+	}
+
+	endModify();
+
+	return kXBusError_NoError;
+}
+
+
+//****************************************************************************
+//	XBusServoEx::getServoByIndex
+//		return :		value of the servo in the channel data packet.  0 if servoNo is out of range
+//		parameter :	servoNo		index of the servo in the order it was added (0 origin)
+//
+//		2026/10/19 : add for the telemetry log
+//****************************************************************************
+unsigned int XBusServoEx::getServoByIndex(int servoNo)
+{
+	int			dataOffset;
+
+	if ((servoNo < 0) || (servoNo >= numOfServo))
+		return 0;
+
+	dataOffset = kStartOffsetOfCHData + kCHDataSize * servoNo;
+	return ((unsigned int)chPacketBuffer[dataOffset + 2] << 8) | chPacketBuffer[dataOffset + 3];
+}
+
+
+//****************************************************************************
+//	XBusServoEx::getNumOfServo
+//		return :	number of servos added
+//		parameter :	none
+//
+//		2026/10/19 : add for the motion player
+//****************************************************************************
+int XBusServoEx::getNumOfServo(void)
+{
+	return numOfServo;
+}
+
+
+//****************************************************************************
+//	XBusServoEx::getServoID
+//		return :	channel ID of the servo.  0 if servoNo is out of range
+//		parameter :	servoNo		index of the servo in the order it was added (0 origin)
+//
+//		2026/10/19 : add for the health monitor
+//****************************************************************************
+char XBusServoEx::getServoID(int servoNo)
+{
+	if ((servoNo < 0) || (servoNo >= numOfServo))
+		return 0;
+
+	return chPacketBuffer[kStartOffsetOfCHData + kCHDataSize * servoNo];
+}
+
+
+//****************************************************************************
+//	XBusServoEx::buildChannelDataPacket
+//		return :	size of the packet to send.  0 if there is nothing to send
+//		parameter :	none
+//
+//		copy the channel data to the send buffer and put CRC on it.
+//		the CRC is calculated here once per frame, not on every setServo call
+//		2026/10/19 : move CRC calculation from addServo / setServo to here
+//		2026/10/19 : apply the slew rate limiter
+//		2026/10/19 : add partial frame
+//		2026/10/19 : add rate class
+//		2026/10/19 : take the snapshot with the sequence counter
+//		2026/10/19 : apply the calibration table
+//		2026/10/19 : resolve the virtual channels in the snapshot
+//****************************************************************************
+int XBusServoEx::buildChannelDataPacket(void)
+{
+	XBusSeq		seq;
+	int			packetSize;
+	int			retry;
+
+	seq = servoSeq;
+	if ((seq == builtSeq) && (! slewing) && (sentValue == NULL) && (rateDivider == NULL))
+		return builtSize;										// nothing changed.  send it again
+
+	// take the snapshot of the channel data.  retry if it is modified during
+	// the copy (only possible from the other core)
+	for (retry = 0; ; retry++)
+	{
+		seq = servoSeq;
+		if (seq & 1)
+			return builtSize;									// in the middle of modifying.  send the last packet again
+		XBUS_MEMORY_BARRIER();
+
+		packetSize = chPacketBuffer[kCHDataPacketLength] + 2;			// without CRC
+		memcpy(sendBuffer, chPacketBuffer, packetSize);
+		if (virtualValue != NULL)
+			applyVirtualChannels();								// the virtual channels are in the snapshot
+
+		XBUS_MEMORY_BARRIER();
+		if (servoSeq == seq)
+			break;
+
+		// sendBuffer is broken
+		builtSeq = seq | 1;
+		builtSize = 0;
+		if (retry >= kXBusSeqRetry)
+			return 0;
+	}
+
+	if (slewValue != NULL)
+		applySlewLimit();
+	if (calTable != NULL)
+		applyCalibration();
+	if ((sentValue != NULL) || (rateDivider != NULL))
+	{
+		packetSize = selectChannels();
+		if (packetSize == kStartOffsetOfCHData)
+			packetSize = -1;									// no servo to send
+	}
+	if (packetSize > 0)
+		sendBuffer[packetSize] = crc8(sendBuffer, packetSize);
+
+	// the servos were added or removed on the other core during the build.
+	// drop this packet and send all servos in the next frame
+	XBUS_MEMORY_BARRIER();
+	if (servoSeq != seq)
+	{
+		builtSeq = seq | 1;
+		builtSize = 0;
+		partialCount = 0;
+		return 0;
+	}
+
+	builtSeq = seq;
+	builtSize = (packetSize > 0) ? sendBuffer[kCHDataPacketLength] + 3 : 0;
+
+	return builtSize;
+}
+
+
+//****************************************************************************
+//	XBusServoEx::beginModify / endModify
+//		return :	none
+//		parameter :	none
+//
+//		put them around the change of the channel data and the servo settings.
+//		servoSeq is odd while changing, and the sender uses the channel data
+//		only when servoSeq is even and not changed during the copy (seqlock).
+//		the writer never waits for the sender.  only one writer at a time
+//		2026/10/19 : replace modifyServosNow with the sequence counter
+//****************************************************************************
+void XBusServoEx::beginModify(void)
+{
+	servoSeq = servoSeq + 1;
+	XBUS_MEMORY_BARRIER();
+}
+
+void XBusServoEx::endModify(void)
+{
+	XBUS_MEMORY_BARRIER();
+	servoSeq = servoSeq + 1;
+}
+
+
+//****************************************************************************
+//	XBusServoEx::setPartialFrame
+//		return :	error code
+//		parameter :	refreshFrames	send all servos once in this number of frames.
+//									0 to send all servos in every frame (default)
+//
+//		send only the servos whose value has changed since the last frame.
+//		all servos are still sent once in refreshFrames to keep them alive.
+//		the buffer is allocated at the first call
+//		2026/10/19 : add partial frame
+//		2026/10/19 : replace modifyServosNow with the sequence counter
+//****************************************************************************
+XBusError XBusServoEx::setPartialFrame(unsigned int refreshFrames)
+{
+	beginModify();
+
+	if (refreshFrames == 0)
+	{
+		if (sentValue != NULL)
+			free(sentValue);
+		sentValue = NULL;
+	}
+	else if (sentValue == NULL)
+	{
+		sentValue = (uint16_t*)malloc(maxServo * sizeof(uint16_t));
+		if (sentValue == NULL)
+		{
+			endModify();
+			return kXBusError_MemoryFull;
+		}
+	}
+
+	partialRefresh = refreshFrames;
+	partialCount = 0;									// send all at the next frame
+
+	endModify();
+
+	return kXBusError_NoError;
+}
+
+
+//****************************************************************************
+//	XBusServoEx::selectChannels
+//		return :	size of the packet without CRC
+//		parameter :	none
+//
+//		pack the servos that should be sent in this frame to the top of
+//		the channel data in sendBuffer.
+//			partial frame : only the servos whose value differs from the last sent value
+//			rate class    : only the servos whose turn comes in this frame
+//		all servos are sent in the refresh frame of the partial frame
+//		2026/10/19 : add partial frame
+//		2026/10/19 : add rate class
+//****************************************************************************
+int XBusServoEx::selectChannels(void)
+{
+	uint8_t*	src;
+	uint8_t*	dst;
+	int			servoNo;
+	char		sendAll = 0;
+
+	if (sentValue != NULL)
+	{
+		sendAll = (partialCount == 0);
+		if (++partialCount >= partialRefresh)
+			partialCount = 0;
+	}
+
+	src = dst = &sendBuffer[kStartOffsetOfCHData];
+	for (servoNo = 0; servoNo < numOfServo; servoNo++, src += kCHDataSize)
+	{
+		if (! sendAll)
+		{
+			// not the turn of this servo.  the servos in same class are spread over the frames
+			if ((rateDivider != NULL) && (((subFrameCount + servoNo) & (rateDivider[servoNo] - 1)) != 0))
+				continue;
+
+			// not changed
+			if ((sentValue != NULL) && (((src[2] << 8) | src[3]) == sentValue[servoNo]))
+				continue;
+		}
+
+		if (sentValue != NULL)
+			sentValue[servoNo] = (src[2] << 8) | src[3];
+		if (dst != src)
+			memcpy(dst, src, kCHDataSize);
+		dst += kCHDataSize;
+	}
+	subFrameCount++;
+
+	sendBuffer[kCHDataPacketLength] = (dst - &sendBuffer[kStartOffsetOfCHData]) + 2;	// add 2 for key and type
+	return dst - sendBuffer;
+}
+
+
+//****************************************************************************
+//	XBusServoEx::setServoRate
+//		return :	error code
+//		parameter :	channelID	channel ID of the XBus servo
+//					divider		the servo is sent once in this number of frames.
+//								1 (default), 2, 4, 8, 16, 32, 64 or 128
+//
+//		set the rate class of the servo.  call sendChannelDataPacket faster than
+//		kXBusInterval (e.g. kXBusInterval / 4) and put the critical servos to 1
+//		and the others to 4 so that the critical servos are updated 4 times
+//		faster while the others keep the normal rate.
+//		the buffer is allocated at the first call
+//		2026/10/19 : add rate class
+//		2026/10/19 : change the rate with the sequence counter
+//****************************************************************************
+XBusError XBusServoEx::setServoRate(char channelID, unsigned char divider)
+{
+	int			servoNo;
+
+	if ((divider == 0) || ((divider & (divider - 1)) != 0))
+		return kXBusError_Unsupported;						// only power of 2
+
+	servoNo = findServo(channelID);
+	if (servoNo < 0)
+		return kXBusError_IDNotFound;
+
+	if (rateDivider == NULL)
+	{
+		uint8_t*	buffer;
+
+		buffer = (uint8_t*)malloc(maxServo);
+		if (buffer == NULL)
+			return kXBusError_MemoryFull;
+		memset(buffer, 1, maxServo);
+
+		beginModify();
+		rateDivider = buffer;
+		endModify();
+	}
+
+	beginModify();
+	rateDivider[servoNo] = divider;
+	endModify();
+
+	return kXBusError_NoError;
+}
+
+
+//****************************************************************************
+//	XBusServoEx::findServo
+//		return :	index of the servo (0 origin).  -1 if not found
+//		parameter :	channelID	channel ID of the XBus servo
+//
+//		2026/10/19 : add
+//****************************************************************************
+int XBusServoEx::findServo(char channelID)
+{
+	int			servoNo;
+
+	channelID &= 0x3F;
+	for (servoNo = 0; servoNo < numOfServo; servoNo++)
+		if (chPacketBuffer[kStartOffsetOfCHData + kCHDataSize * servoNo] == channelID)
+			return servoNo;
+
+	return -1;
+}
+
+
+//****************************************************************************
+//	XBusServoEx::initSlotData
+//		return :	none
+//		parameter :	servoNo		index of the servo just added
+//					value		initial value of the servo
+//
+//		initialize the per servo data of the options for new servo
+//		2026/10/19 : add for the slew rate limiter
+//		2026/10/19 : add partial frame
+//		2026/10/19 : add rate class
+//		2026/10/19 : add servo statistics
+//		2026/10/19 : add calibration table
+//		2026/10/19 : add virtual channel
+//****************************************************************************
+void XBusServoEx::initSlotData(int servoNo, unsigned int value)
+{
+	if (slewValue != NULL)
+	{
+		slewValue[servoNo] = value;
+		slewStep[servoNo] = 0;
+		slewMaxStep[servoNo] = 0;
+		slewMaxAccel[servoNo] = 0;
+	}
+	if (sentValue != NULL)
+		partialCount = 0;								// send all at the next frame
+	if (rateDivider != NULL)
+		rateDivider[servoNo] = 1;
+	if (calTable != NULL)
+		calTable[servoNo] = NULL;
+	if (virtualValue != NULL)
+		virtualSource[servoNo] = kXBusVirtualNone;
+	if (servoStats != NULL)
+		memset(&servoStats[servoNo], 0, sizeof(XBusServoStats));
+}
+
+
+//****************************************************************************
+//	XBusServoEx::removeSlotData
+//		return :	none
+//		parameter :	servoNo		index of the servo to be removed
+//
+//		shift the per servo data of the options same as the channel packet.
+//		this must be called before numOfServo is decremented
+//		2026/10/19 : add for the slew rate limiter
+//		2026/10/19 : add partial frame
+//		2026/10/19 : add rate class
+//		2026/10/19 : add servo statistics
+//		2026/10/19 : add calibration table
+//		2026/10/19 : add virtual channel
+//****************************************************************************
+void XBusServoEx::removeSlotData(int servoNo)
+{
+	int			moveSize;
+
+	moveSize = numOfServo - servoNo - 1;
+	if (moveSize <= 0)
+		return;
+
+	if (slewValue != NULL)
+	{
+		memmove(&slewValue[servoNo], &slewValue[servoNo + 1], moveSize * sizeof(uint16_t));
+		memmove(&slewStep[servoNo], &slewStep[servoNo + 1], moveSize * sizeof(long));
+		memmove(&slewMaxStep[servoNo], &slewMaxStep[servoNo + 1], moveSize * sizeof(uint16_t));
+		memmove(&slewMaxAccel[servoNo], &slewMaxAccel[servoNo + 1], moveSize * sizeof(uint16_t));
+	}
+	if (sentValue != NULL)
+		memmove(&sentValue[servoNo], &sentValue[servoNo + 1], moveSize * sizeof(uint16_t));
+	if (rateDivider != NULL)
+		memmove(&rateDivider[servoNo], &rateDivider[servoNo + 1], moveSize);
+	if (calTable != NULL)
+	{
+		memmove(&calTable[servoNo], &calTable[servoNo + 1], moveSize * sizeof(const uint16_t*));
+		memmove(&calShift[servoNo], &calShift[servoNo + 1], moveSize);
+	}
+	if (virtualValue != NULL)
+	{
+		memmove(&virtualScale[servoNo], &virtualScale[servoNo + 1], moveSize * sizeof(int16_t));
+		memmove(&virtualOffset[servoNo], &virtualOffset[servoNo + 1], moveSize * sizeof(int16_t));
+		memmove(&virtualSource[servoNo], &virtualSource[servoNo + 1], moveSize);
+	}
+	if (servoStats != NULL)
+		memmove(&servoStats[servoNo], &servoStats[servoNo + 1], moveSize * sizeof(XBusServoStats));
+}
+
+
+//****************************************************************************
+//	XBusServoEx::setServoLimit
+//		return :	error code
+//		parameter :	channelID	channel ID of the XBus servo
+//					maxStep		max move in one frame (raw value).  0 for no limit
+//					maxAccel	max change of the move in one frame (raw value).  0 for no limit
+//
+//		set the slew rate and acceleration limit of the servo.  the limit is
+//		applied to all servos at once when the channel packet is built, so
+//		setServo can keep to set the target value directly.
+//		the buffer for the limiter is allocated at the first call
+//		2026/10/19 : add slew rate limiter
+//		2026/10/19 : replace modifyServosNow with the sequence counter
+//		2026/10/19 : change the limits with the sequence counter
+//****************************************************************************
+XBusError XBusServoEx::setServoLimit(char channelID, unsigned int maxStep, unsigned int maxAccel)
+{
+	int			servoNo;
+
+	servoNo = findServo(channelID);
+	if (servoNo < 0)
+		return kXBusError_IDNotFound;
+
+	if (slewValue == NULL)
+	{
+		long*		buffer;
+		uint16_t*	value;
+		int			index;
+
+		// the moves first for the alignment of long
+		buffer = (long*)malloc(maxServo * (sizeof(long) + sizeof(uint16_t) * 3));
+		if (buffer == NULL)
+			return kXBusError_MemoryFull;
+		value = (uint16_t*)&buffer[maxServo];
+
+		beginModify();
+
+		slewStep = buffer;
+		slewMaxStep = &value[maxServo];
+		slewMaxAccel = &value[maxServo * 2];
+		for (index = 0; index < numOfServo; index++)
+		{
+			int		dataOffset = kStartOffsetOfCHData + kCHDataSize * index;
+
+			value[index] = (chPacketBuffer[dataOffset + 2] << 8) | chPacketBuffer[dataOffset + 3];
+			slewStep[index] = 0;
+			slewMaxStep[index] = 0;
+			slewMaxAccel[index] = 0;
+		}
+		slewValue = value;
+
+		endModify();
+	}
+
+	beginModify();
+	slewMaxStep[servoNo] = maxStep;
+	slewMaxAccel[servoNo] = maxAccel;
+	endModify();
+
+	return kXBusError_NoError;
+}
+
+
+//****************************************************************************
+//	XBusServoEx::setServoCalibration / setServoCalibration_P
+//		return :	error code
+//		parameter :	channelID	channel ID of the XBus servo
+//					table		output value at the breakpoints.  NULL to remove
+//					numOfPoints	number of the breakpoints.  2^n + 1 (9, 17 ...)
+//
+//		set the calibration table of the servo.  the value set by setServo is
+//		divided into numOfPoints - 1 segments of the same width, and the output
+//		is interpolated linearly between table[i] for the value
+//		i * 65536 / (numOfPoints - 1) and table[i + 1].  (the last point is for
+//		0x10000.)  the table is not copied, so it must be kept.
+//		setServoCalibration_P is for the table in PROGMEM.  for the table kept
+//		in EEPROM, read it to RAM and use setServoCalibration.
+//		the buffer for the tables is allocated at the first call
+//		2026/10/19 : add calibration table
+//****************************************************************************
+XBusError XBusServoEx::setServoCalibration(char channelID, const uint16_t* table, uint8_t numOfPoints)
+{
+	return setCalibration(channelID, table, numOfPoints, 0);
+}
+
+XBusError XBusServoEx::setServoCalibration_P(char channelID, const uint16_t* table, uint8_t numOfPoints)
+{
+	return setCalibration(channelID, table, numOfPoints, kXBusCalProgmem);
+}
+
+
+//****************************************************************************
+//	XBusServoEx::setCalibration
+//		return :	error code
+//		parameter :	channelID	channel ID of the XBus servo
+//					table		output value at the breakpoints.  NULL to remove
+//					numOfPoints	number of the breakpoints
+//					flags		kXBusCalProgmem for the table in PROGMEM
+//
+//		common part of setServoCalibration and setServoCalibration_P
+//		2026/10/19 : add calibration table
+//****************************************************************************
+XBusError XBusServoEx::setCalibration(char channelID, const uint16_t* table, uint8_t numOfPoints, uint8_t flags)
+{
+	int			servoNo;
+	uint8_t		shift;
+
+	servoNo = findServo(channelID);
+	if (servoNo < 0)
+		return kXBusError_IDNotFound;
+
+	// 2^n segments.  shift is the bits of the position in a segment
+	shift = 16;
+	if (table != NULL)
+	{
+		unsigned int	segments = numOfPoints - 1;
+
+		if ((numOfPoints < kXBusCalMinPoints) || (numOfPoints > kXBusCalMaxPoints) || (segments & (segments - 1)))
+			return kXBusError_Unsupported;
+		while (segments > 1)
+		{
+			segments >>= 1;
+			shift--;
+		}
+	}
+
+	if (calTable == NULL)
+	{
+		uint8_t*	buffer;
+		int			index;
+
+		if (table == NULL)
+			return kXBusError_NoError;
+
+		buffer = (uint8_t*)malloc(maxServo * (sizeof(const uint16_t*) + 1));
+		if (buffer == NULL)
+			return kXBusError_MemoryFull;
+
+		for (index = 0; index < (int)maxServo; index++)
+			((const uint16_t**)buffer)[index] = NULL;
+		calShift = buffer + maxServo * sizeof(const uint16_t*);
+		beginModify();
+		calTable = (const uint16_t**)buffer;
+		endModify();
+	}
+
+	beginModify();
+	calTable[servoNo] = table;
+	calShift[servoNo] = shift | flags;
+	endModify();
+
+	return kXBusError_NoError;
+}
+
+
+//****************************************************************************
+//	XBusServoEx::applyCalibration
+//		return :	none
+//		parameter :	none
+//
+//		replace the value of the calibrated servos in sendBuffer with the
+//		output interpolated from the table.  the segment is found by the
+//		shift, so it costs one multiply for each servo
+//		2026/10/19 : add calibration table
+//****************************************************************************
+void XBusServoEx::applyCalibration(void)
+{
+	uint8_t*	data;
+	int			servoNo;
+
+	data = &sendBuffer[kStartOffsetOfCHData + 2];
+	for (servoNo = 0; servoNo < numOfServo; servoNo++, data += kCHDataSize)
+	{
+		const uint16_t*	table = calTable[servoNo];
+		uint8_t			shift;
+		unsigned int	value;
+		unsigned int	from;
+		unsigned int	to;
+		unsigned int	offset;
+
+		if (table == NULL)
+			continue;
+
+		shift = calShift[servoNo];
+		value = (data[0] << 8) | data[1];
+		table += value >> (shift & 0x1F);
+		if (shift & kXBusCalProgmem)
+		{
+			from = pgm_read_word(table);
+			to = pgm_read_word(table + 1);
+		}
+		else
+		{
+			from = table[0];
+			to = table[1];
+		}
+		shift &= 0x1F;
+		offset = value & ((1U << shift) - 1);
+
+		value = from + (int)(((long)to - (long)from) * (long)offset >> shift);
+		data[0] = value >> 8;
+		data[1] = value;
+	}
+}
+
+
+//****************************************************************************
+//	XBusServoEx::setVirtualTarget
+//		return :	error code
+//		parameter :	virtualNo	virtual channel (0 to maxServoNum - 1).
+//								kXBusVirtualNone to unlink the servo
+//					channelID	channel ID of the XBus servo to link
+//					reverse		1 to move the servo in the opposite direction
+//					offset		raw value added to the output
+//					scale		move of the servo for the move of the virtual
+//								channel.  kXBusVirtualScaleOne for 1.0
+//
+//		link the servo to the virtual channel.  the output of the servo is
+//			neutral + (value - neutral) * scale (negative if reverse) + offset
+//		for the value of the virtual channel, limited to 0x0000 - 0xFFFF.
+//		some servos can be linked to one virtual channel, and they are
+//		always sent in the same frame.  setServo of the linked servo has no
+//		effect.  the buffer is allocated at the first call
+//		2026/10/19 : add virtual channel
+//****************************************************************************
+XBusError XBusServoEx::setVirtualTarget(uint8_t virtualNo, char channelID, char reverse, int offset, int scale)
+{
+	int			servoNo;
+
+	if ((virtualNo >= maxServo) && (virtualNo != kXBusVirtualNone))
+		return kXBusError_Unsupported;
+
+	servoNo = findServo(channelID);
+	if (servoNo < 0)
+		return kXBusError_IDNotFound;
+
+	if (virtualValue == NULL)
+	{
+		uint8_t*	buffer;
+		int			index;
+
+		if (virtualNo == kXBusVirtualNone)
+			return kXBusError_NoError;
+
+		buffer = (uint8_t*)malloc(maxServo * (sizeof(uint16_t) + sizeof(int16_t) * 2 + 1));
+		if (buffer == NULL)
+			return kXBusError_MemoryFull;
+
+		virtualScale = (int16_t*)&buffer[maxServo * sizeof(uint16_t)];
+		virtualOffset = (int16_t*)&buffer[maxServo * (sizeof(uint16_t) + sizeof(int16_t))];
+		virtualSource = &buffer[maxServo * (sizeof(uint16_t) + sizeof(int16_t) * 2)];
+		for (index = 0; index < (int)maxServo; index++)
+		{
+			((uint16_t*)buffer)[index] = kXbusServoNeutral;
+			virtualSource[index] = kXBusVirtualNone;
+		}
+
+		beginModify();
+		virtualValue = (uint16_t*)buffer;
+		endModify();
+	}
+
+	beginModify();
+	virtualSource[servoNo] = virtualNo;
+	virtualScale[servoNo] = reverse ? -scale : scale;
+	virtualOffset[servoNo] = offset;
+	endModify();
+
+	return kXBusError_NoError;
+}
+
+
+//****************************************************************************
+//	XBusServoEx::setVirtual
+//		return :	error code
+//		parameter :	virtualNo	virtual channel
+//					value		value of the virtual channel
+//
+//		set the value of the virtual channel.  all servos linked to it move
+//		from the next frame
+//		2026/10/19 : add virtual channel
+//****************************************************************************
+XBusError XBusServoEx::setVirtual(uint8_t virtualNo, unsigned int value)
+{
+	if ((virtualValue == NULL) || (virtualNo >= maxServo))
+		return kXBusError_IDNotFound;
+
+	beginModify();
+	virtualValue[virtualNo] = value;
+	endModify();
+
+	return kXBusError_NoError;
+}
+
+
+//****************************************************************************
+//	XBusServoEx::applyVirtualChannels
+//		return :	none
+//		parameter :	none
+//
+//		write the output of the servos linked to the virtual channels to
+//		sendBuffer in one pass.  this is called in the snapshot of the
+//		channel data, so the virtual channels are taken with the servos
+//		2026/10/19 : add virtual channel
+//****************************************************************************
+void XBusServoEx::applyVirtualChannels(void)
+{
+	uint8_t*	data;
+	int			servoNo;
+
+	data = &sendBuffer[kStartOffsetOfCHData + 2];
+	for (servoNo = 0; servoNo < numOfServo; servoNo++, data += kCHDataSize)
+	{
+		uint8_t		source = virtualSource[servoNo];
+		long		value;
+
+		if (source == kXBusVirtualNone)
+			continue;
+
+		value = (long)virtualValue[source] - kXbusServoNeutral;
+		value = kXbusServoNeutral + ((value * virtualScale[servoNo]) >> 12) + virtualOffset[servoNo];
+		if (value < 0)
+			value = 0;
+		else if (value > 0xFFFF)
+			value = 0xFFFF;
+
+		data[0] = value >> 8;
+		data[1] = value;
+	}
+}
+
+
+//****************************************************************************
+//	XBusServoEx::applySlewLimit
+//		return :	none
+//		parameter :	none
+//
+//		move the output value of each servo to the target value in sendBuffer
+//		within the limits and write it back to sendBuffer.
+//		the servo slows down before the target so that it does not overshoot
+//		and the move at the target is within the acceleration limit
+//		2026/10/19 : add slew rate limiter
+//		2026/10/19 : plan the slow down.  the move is kept in long
+//****************************************************************************
+void XBusServoEx::applySlewLimit(void)
+{
+	uint8_t*	data;
+	int			servoNo;
+	char		moving = 0;
+
+	data = &sendBuffer[kStartOffsetOfCHData + 2];
+	for (servoNo = 0; servoNo < numOfServo; servoNo++, data += kCHDataSize)
+	{
+		long			diff;
+		long			step;
+		long			value;
+		unsigned long	limit;
+
+		diff = (long)((data[0] << 8) | data[1]) - slewValue[servoNo];
+		limit = slewMaxStep[servoNo];
+		if (slewMaxAccel[servoNo] == 0)
+		{
+			// only the slew rate limit.  never go over the target
+			step = diff;
+			if (limit != 0)
+			{
+				if (step > (long)limit)
+					step = limit;
+				else if (step < -(long)limit)
+					step = -(long)limit;
+			}
+		}
+		else
+		{
+			long	accel = slewMaxAccel[servoNo];
+			long	speed;
+			long	maxSpeed;
+
+			// the move to the target is positive here
+			speed = (diff >= 0) ? slewStep[servoNo] : -slewStep[servoNo];
+			maxSpeed = speed + accel;
+			if ((limit != 0) && (maxSpeed > (long)limit))
+				maxSpeed = limit;
+
+			if (maxSpeed > 0)
+				maxSpeed = getSlewSpeed((diff >= 0) ? diff : -diff, accel, maxSpeed);
+
+			// it can not slow down more than the acceleration limit.
+			// it goes over the target and comes back if the target is changed too near
+			step = (maxSpeed < speed - accel) ? speed - accel : maxSpeed;
+			if (diff < 0)
+				step = -step;
+		}
+
+		value = slewValue[servoNo] + step;
+		if (value < 0)
+			value = 0;
+		else if (value > 0xFFFF)
+			value = 0xFFFF;
+		step = value - slewValue[servoNo];
 
-				// atomic flag off
-				modifyServosNow = 0;
+		slewValue[servoNo] = value;
+		slewStep[servoNo] = step;
+		if ((step != 0) || (diff != 0))
+			moving = 1;
 
-				return kXBusError_NoError;
-			}
+		data[0] = (value >> 8) & 0x00FF;
+		data[1] = value & 0x00FF;
 	}
-	
-	return kXBusError_IDNotFound;
+
+	slewing = moving;
 }
 
 
 //****************************************************************************
-//	XBusServoEx::setServo
-//		return :		error code
-//		parameter :	channelID	channel ID of the XBus servo that you want to set
-//					value		value of this XBus servo
-//								use kXBusServoExNeutral for center of the XBus servo
+//	XBusServoEx::getSlewSpeed
+//		return :	max move in this frame
+//		parameter :	distance	distance to the target
+//					accel		max change of the move in one frame
+//					maxSpeed	max move by the acceleration and the slew rate limit
 //
-//		set new value to the servo
-//		2014/05/14 : add header by Sawa
-//****************************************************************************
-XBusError XBusServoEx::setServo(char channelID, unsigned int value)
+//		the move of m frames to stop is speed, speed - accel, ... and the last one
+//		is from 1 to accel, so the servo stops at the target in the next frame.
+//		m is the max one that the shortest moves of m frames are shorter than
+//		the distance, found by the binary search.  then the move is the one that
+//		m frames move the distance
+//		2026/10/19 : plan the slow down of the slew rate limiter
+//****************************************************************************
+long XBusServoEx::getSlewSpeed(unsigned long distance, long accel, long maxSpeed)
 {
-	int			dataOffset;
+	unsigned long	low = 1;
+	unsigned long	high = maxSpeed / accel + 1;
+	unsigned long	frames;
+	unsigned long	speed;
 
-	// convert to servo ID
-	channelID &= 0x3F;
-	
-	// scan servo ID that is already added
-	if (numOfServo > 0)
-	{
-		int		servoNo;
+	if (distance == 0)
+		return 0;
 
-		for (servoNo = 0; servoNo < numOfServo; servoNo++)
-		{
-			dataOffset = kStartOffsetOfCHData + kCHDataSize * servoNo;
-			
-			if (chPacketBuffer[dataOffset] == channelID)
-			{
-				// atomic flag on
-				modifyServosNow = 1;
-				
-				// set value
-				chPacketBuffer[dataOffset + 2] = (value >> 8) & 0x00FF;
-				chPacketBuffer[dataOffset + 3] = value & 0x00FF;
+	// accel * m * (m - 1) / 2 < distance for m = low
+	while (low < high)
+	{
+		frames = (low + high + 1) >> 1;
+		if ((unsigned long)accel * frames * (frames - 1) / 2 < distance)
+			low = frames;
+		else
+			high = frames - 1;
+	}
+	frames = low;
 
-				// calc CRC
-				chPacketBuffer[kStartOffsetOfCHData + kCHDataSize * numOfServo]
-						= crc8(chPacketBuffer, chPacketBuffer[kCHDataPacketLength] + 2);
-				dirty = 1;
+	speed = (distance + (unsigned long)accel * frames * (frames - 1) / 2) / frames;
+	if (speed > (unsigned long)maxSpeed)
+		speed = maxSpeed;
 
-				// atomic flag off
-				modifyServosNow = 0;
-				
-				return kXBusError_NoError;
-			}
-		}
-	}
-	
-	return kXBusError_IDNotFound;
+	return speed;
 }
 
 
@@ -517,31 +2278,20 @@ XBusError XBusServoEx::setChannelID(char newChannelID)
 //
 //		get the data size of this order
 //		2014/05/15 : add header by Sawa
+//		2026/10/19 : made from the order descriptor table
 //****************************************************************************
 int	XBusServoEx::getDataSize(char	order)
 {
-	char		dataSize = 1;
-	
 	switch(order)
 	{
-		case kXBusOrder_2_Version:		// only for get
-		case kXBusOrder_2_Product:		// only for get
-		case kXBusOrder_2_Reset:			// only for set
-		case kXBusOrder_2_ParamWrite:			// only for set
-		case kXBusOrder_2_Reverse:
-		case kXBusOrder_2_Neutral:
-		case kXBusOrder_2_H_Travel:
-		case kXBusOrder_2_L_Travel:
-		case kXBusOrder_2_H_Limit:
-		case kXBusOrder_2_L_Limit:
-		case kXBusOrder_2_PowerOffset:
-		case kXBusOrder_2_AlarmDelay:
-		case kXBusOrder_2_CurrentPos:		// only for get
-		case kXBusOrder_2_MaxInteger:
-			dataSize = 2;
+#define	XBusOrderSizeCase(order, size, isSigned, access, index, low, high) \
+		case order: \
+			return size;
+		XBusOrderTable(XBusOrderSizeCase)
+#undef	XBusOrderSizeCase
 	}
 
-	return dataSize;
+	return 1;
 }
 
 
@@ -613,29 +2363,16 @@ XBusError XBusServoEx::setCommand(char order, int* value)
 //****************************************************************************
 XBusError XBusServoEx::begin1(void)
 {
-	int				bufferSize;						// channel data packet buffer size
+	XBusError		result;
 
-	bufferSize = kStartOffsetOfCHData + maxServo * kCHDataSize + 1;		// add 1 for CRC
-	if (bufferSize < kCmdDataPacketSize)
-		bufferSize = kCmdDataPacketSize;
-	chPacketBuffer = (uint8_t*)malloc(bufferSize);
-	if (chPacketBuffer == NULL)
-		return kXBusError_MemoryFull;
-	sendBuffer = (uint8_t*)malloc(bufferSize);
-	if (sendBuffer == NULL)
-	{
-		free(chPacketBuffer);
-		return kXBusError_MemoryFull;
-	}
+	result = allocBuffers();
+	if (result != kXBusError_NoError)
+		return result;
 
-	// initialize channel packer buffer
-	chPacketBuffer[kCHDataPacketCommand]	= kXBusCmd_ModeA;
-	chPacketBuffer[kCHDataPacketLength]		= 0x00;
-	chPacketBuffer[kCHDataPacketKey]			= 0x00;
-	chPacketBuffer[kCHDataPacketType]			= 0x00;
-	
 	Serial1.begin(kXBusBaudrate);
 	Serial1.setTimeout(300);
+	xbusSerial = &Serial1;
+	setTxUSART(1);
 
 	return kXBusError_NoError;
 }
@@ -654,29 +2391,16 @@ XBusError XBusServoEx::begin1(void)
 //****************************************************************************
 XBusError XBusServoEx::begin2(void)
 {
-	int				bufferSize;						// channel data packet buffer size
+	XBusError		result;
 
-	bufferSize = kStartOffsetOfCHData + maxServo * kCHDataSize + 1;		// add 1 for CRC
-	if (bufferSize < kCmdDataPacketSize)
-		bufferSize = kCmdDataPacketSize;
-	chPacketBuffer = (uint8_t*)malloc(bufferSize);
-	if (chPacketBuffer == NULL)
-		return kXBusError_MemoryFull;
-	sendBuffer = (uint8_t*)malloc(bufferSize);
-	if (sendBuffer == NULL)
-	{
-		free(chPacketBuffer);
-		return kXBusError_MemoryFull;
-	}
+	result = allocBuffers();
+	if (result != kXBusError_NoError)
+		return result;
 
-	// initialize channel packer buffer
-	chPacketBuffer[kCHDataPacketCommand]	= kXBusCmd_ModeA;
-	chPacketBuffer[kCHDataPacketLength]		= 0x00;
-	chPacketBuffer[kCHDataPacketKey]			= 0x00;
-	chPacketBuffer[kCHDataPacketType]			= 0x00;
-	
 	Serial2.begin(kXBusBaudrate);
 	Serial2.setTimeout(300);
+	xbusSerial = &Serial2;
+	setTxUSART(2);
 
 	return kXBusError_NoError;
 }
@@ -693,12 +2417,11 @@ XBusError XBusServoEx::begin2(void)
 void XBusServoEx::end1(void)
 {
 	Serial1.end();
+	xbusSerial = NULL;
+	setTxUSART(-1);
 	pinMode(this->dirPinNo, INPUT);
 
-	if (chPacketBuffer != NULL)
-		free(chPacketBuffer);
-	if (sendBuffer != NULL)
-		free(sendBuffer);
+	freeBuffers();
 }
 
 //****************************************************************************
@@ -714,12 +2437,11 @@ void XBusServoEx::end1(void)
 void XBusServoEx::end2(void)
 {
 	Serial2.end();
+	xbusSerial = NULL;
+	setTxUSART(-1);
 	pinMode(this->dirPinNo, INPUT);
 
-	if (chPacketBuffer != NULL)
-		free(chPacketBuffer);
-	if (sendBuffer != NULL)
-		free(sendBuffer);
+	freeBuffers();
 }
 
 
@@ -735,19 +2457,11 @@ void XBusServoEx::end2(void)
 //****************************************************************************
 void XBusServoEx::sendChannelDataPacket1(void)
 {
-	if (modifyServosNow)
-		return;
-	
-	if (numOfServo > 0)
-	{
-		if (dirty)
-		{
-			memcpy(sendBuffer, chPacketBuffer, chPacketBuffer[kCHDataPacketLength] + 3);
-			dirty = 0;
-		}
-		
-		Serial1.write(sendBuffer, sendBuffer[kCHDataPacketLength] + 3);
-	}
+	int		sendSize;
+
+	sendSize = prepareChannelDataPacket();
+	if (sendSize > 0)
+		Serial1.write(sendBuffer, sendSize);
 }
 
 //****************************************************************************
@@ -762,259 +2476,13 @@ void XBusServoEx::sendChannelDataPacket1(void)
 //****************************************************************************
 void XBusServoEx::sendChannelDataPacket2(void)
 {
-	if (modifyServosNow)
-		return;
-	
-	if (numOfServo > 0)
-	{
-		if (dirty)
-		{
-			memcpy(sendBuffer, chPacketBuffer, chPacketBuffer[kCHDataPacketLength] + 3);
-			dirty = 0;
-		}
-		
-		Serial2.write(sendBuffer, sendBuffer[kCHDataPacketLength] + 3);
-	}
-}
-
-
-//****************************************************************************
-//	XBusServoEx::sendCommandDataPacket1
-//		return :	error code
-//		parameter :	command		The commnad that you want to send
-//					channelID	The channel ID of the XBus servo that you want to set up
-//					order		The order that you want to set up
-//					value		The value that you want to set / get
-//					valueSize	The value size.  1 byte(char) or 2 byte(int)
-//
-//		This should NOT be called on the timer handler like MsTimer2 when you
-//		setup the XBus servo.
-//		2014/05/14 : add header by Sawa
-// 		2023/11/26 : added by Izumi Ninagawa
-//****************************************************************************
-XBusError XBusServoEx::sendCommandDataPacket1(char command, char channelID, char order, int* value, char valueSize)
-{
-	int					sendSize;
-	int					recieveSize;
-	
-	// setup command
-	sendBuffer[kCmdDataPacketCommand] = command;
-	sendBuffer[kCmdDataPacketLength] = valueSize + 3;
-	sendBuffer[kCmdDataPacketKey] = 0x00;
-	sendBuffer[kCmdDataPacketCH_ID] = channelID;
-	sendBuffer[kCmdDataPacketOrder] = order;
-	if (valueSize == 1)						// 1 byte value
-	{
-		sendBuffer[kCmdDataPacketData1] = *value & 0x00FF;
-		sendBuffer[kCmdDataPacketData2] = crc8(sendBuffer, sendBuffer[kCHDataPacketLength] + 2);
-	}
-	else
-	{
-		sendBuffer[kCmdDataPacketData1] = (*value >> 8) & 0x00FF;
-		sendBuffer[kCmdDataPacketData2] = *value & 0x00FF;		
-		sendBuffer[kCmdDataPacketCRC] = crc8(sendBuffer, sendBuffer[kCHDataPacketLength] + 2);
-	}
-	
-	// to recover channel data packet when you call sendChannelDataPacket after this
-	dirty = 1;
-
-	// send command
-	sendSize = sendBuffer[kCmdDataPacketLength] + 3;
-	while(Serial1.read() >= 0)
-		;																				// flush the receive buffer
-	Serial1.write(sendBuffer, sendSize);
-	Serial1.flush();														// wait to send all bytes
-
-	// change bus direction to Rx mode
-	if (dirPinNo >= 0)
-		digitalWrite(dirPinNo, HIGH);
-	
-	if (channelID != 0)
-	{
-		// dummy read for sent packet
-		recieveSize = Serial1.readBytes((char*)sendBuffer, sendSize);
-		if (recieveSize == 0)
-		{
-		// change bus direction to Tx mode
-			if (dirPinNo >= 0)
-				digitalWrite(dirPinNo, LOW);
-			return kXBusError_TimeOut;
-		}
-
-		// read packet
-		recieveSize = Serial1.readBytes((char*)sendBuffer, 2);
-		if (recieveSize == 0)
-		{
-		// change bus direction to Tx mode
-			if (dirPinNo >= 0)
-				digitalWrite(dirPinNo, LOW);
-			return kXBusError_TimeOut;
-		}
-		
-		Serial1.readBytes((char*)&(sendBuffer[kCmdDataPacketKey]), sendBuffer[kCHDataPacketLength] + 1);
-		if (recieveSize == 0)
-		{
-		// change bus direction to Tx mode
-			if (dirPinNo >= 0)
-				digitalWrite(dirPinNo, LOW);
-			return kXBusError_TimeOut;
-		}
-
-		// change bus direction to Tx mode
-		if (dirPinNo >= 0)
-			digitalWrite(dirPinNo, LOW);
-
-		// check CRC
-		if (crc8(sendBuffer, sendBuffer[kCHDataPacketLength] + 3) != 0)
-			return kXBusError_CRCError;
-
-		// check unsupported
-		if (sendBuffer[kCmdDataPacketOrder] == kXBusOrder_1_Unsupported)
-			return kXBusError_Unsupported;
-
-		// send bcak the value
-		if (valueSize == 1)						// 1 byte value
-		{
-			*value = sendBuffer[kCmdDataPacketData1];
-			if (*value & 0x0080)
-				*value |= 0xFF00;
-		}
-		else
-		{
-			*value = sendBuffer[kCmdDataPacketData1];
-			*value <<= 8;
-			*value |= sendBuffer[kCmdDataPacketData2];		
-		}
+	int		sendSize;
 
-		return kXBusError_NoError;
-	}
-	else
-	{
-		// change bus direction to Tx mode
-		if (dirPinNo >= 0)
-			digitalWrite(dirPinNo, LOW);
-		return kXBusError_NoError;
-	}
+	sendSize = prepareChannelDataPacket();
+	if (sendSize > 0)
+		Serial2.write(sendBuffer, sendSize);
 }
 
-//****************************************************************************
-//	XBusServoEx::sendCommandDataPacket2
-//		return :	error code
-//		parameter :	command		The commnad that you want to send
-//					channelID	The channel ID of the XBus servo that you want to set up
-//					order		The order that you want to set up
-//					value		The value that you want to set / get
-//					valueSize	The value size.  1 byte(char) or 2 byte(int)
-//
-//		This should NOT be called on the timer handler like MsTimer2 when you
-//		setup the XBus servo.
-//		2014/05/14 : add header by Sawa
-// 		2023/11/26 : added by Izumi Ninagawa
-//****************************************************************************
-XBusError XBusServoEx::sendCommandDataPacket2(char command, char channelID, char order, int* value, char valueSize)
-{
-	int					sendSize;
-	int					recieveSize;
-	
-	// setup command
-	sendBuffer[kCmdDataPacketCommand] = command;
-	sendBuffer[kCmdDataPacketLength] = valueSize + 3;
-	sendBuffer[kCmdDataPacketKey] = 0x00;
-	sendBuffer[kCmdDataPacketCH_ID] = channelID;
-	sendBuffer[kCmdDataPacketOrder] = order;
-	if (valueSize == 1)						// 1 byte value
-	{
-		sendBuffer[kCmdDataPacketData1] = *value & 0x00FF;
-		sendBuffer[kCmdDataPacketData2] = crc8(sendBuffer, sendBuffer[kCHDataPacketLength] + 2);
-	}
-	else
-	{
-		sendBuffer[kCmdDataPacketData1] = (*value >> 8) & 0x00FF;
-		sendBuffer[kCmdDataPacketData2] = *value & 0x00FF;		
-		sendBuffer[kCmdDataPacketCRC] = crc8(sendBuffer, sendBuffer[kCHDataPacketLength] + 2);
-	}
-	
-	// to recover channel data packet when you call sendChannelDataPacket after this
-	dirty = 1;
-
-	// send command
-	sendSize = sendBuffer[kCmdDataPacketLength] + 3;
-	while(Serial2.read() >= 0)
-		;																				// flush the receive buffer
-	Serial2.write(sendBuffer, sendSize);
-	Serial2.flush();														// wait to send all bytes
-
-	// change bus direction to Rx mode
-	if (dirPinNo >= 0)
-		digitalWrite(dirPinNo, HIGH);
-	
-	if (channelID != 0)
-	{
-		// dummy read for sent packet
-		recieveSize = Serial2.readBytes((char*)sendBuffer, sendSize);
-		if (recieveSize == 0)
-		{
-		// change bus direction to Tx mode
-			if (dirPinNo >= 0)
-				digitalWrite(dirPinNo, LOW);
-			return kXBusError_TimeOut;
-		}
-
-		// read packet
-		recieveSize = Serial2.readBytes((char*)sendBuffer, 2);
-		if (recieveSize == 0)
-		{
-		// change bus direction to Tx mode
-			if (dirPinNo >= 0)
-				digitalWrite(dirPinNo, LOW);
-			return kXBusError_TimeOut;
-		}
-		
-		Serial2.readBytes((char*)&(sendBuffer[kCmdDataPacketKey]), sendBuffer[kCHDataPacketLength] + 1);
-		if (recieveSize == 0)
-		{
-		// change bus direction to Tx mode
-			if (dirPinNo >= 0)
-				digitalWrite(dirPinNo, LOW);
-			return kXBusError_TimeOut;
-		}
-
-		// change bus direction to Tx mode
-		if (dirPinNo >= 0)
-			digitalWrite(dirPinNo, LOW);
-
-		// check CRC
-		if (crc8(sendBuffer, sendBuffer[kCHDataPacketLength] + 3) != 0)
-			return kXBusError_CRCError;
-
-		// check unsupported
-		if (sendBuffer[kCmdDataPacketOrder] == kXBusOrder_1_Unsupported)
-			return kXBusError_Unsupported;
-
-		// send bcak the value
-		if (valueSize == 1)						// 1 byte value
-		{
-			*value = sendBuffer[kCmdDataPacketData1];
-			if (*value & 0x0080)
-				*value |= 0xFF00;
-		}
-		else
-		{
-			*value = sendBuffer[kCmdDataPacketData1];
-			*value <<= 8;
-			*value |= sendBuffer[kCmdDataPacketData2];		
-		}
-
-		return kXBusError_NoError;
-	}
-	else
-	{
-		// change bus direction to Tx mode
-		if (dirPinNo >= 0)
-			digitalWrite(dirPinNo, LOW);
-		return kXBusError_NoError;
-	}
-}
 
 #endif
 
@@ -1035,29 +2503,16 @@ XBusError XBusServoEx::sendCommandDataPacket2(char command, char channelID, char
 //****************************************************************************
 XBusError XBusServoEx::begin3(void)
 {
-	int				bufferSize;						// channel data packet buffer size
-
-	bufferSize = kStartOffsetOfCHData + maxServo * kCHDataSize + 1;		// add 1 for CRC
-	if (bufferSize < kCmdDataPacketSize)
-		bufferSize = kCmdDataPacketSize;
-	chPacketBuffer = (uint8_t*)malloc(bufferSize);
-	if (chPacketBuffer == NULL)
-		return kXBusError_MemoryFull;
-	sendBuffer = (uint8_t*)malloc(bufferSize);
-	if (sendBuffer == NULL)
-	{
-		free(chPacketBuffer);
-		return kXBusError_MemoryFull;
-	}
+	XBusError		result;
+
+	result = allocBuffers();
+	if (result != kXBusError_NoError)
+		return result;
 
-	// initialize channel packer buffer
-	chPacketBuffer[kCHDataPacketCommand]	= kXBusCmd_ModeA;
-	chPacketBuffer[kCHDataPacketLength]		= 0x00;
-	chPacketBuffer[kCHDataPacketKey]			= 0x00;
-	chPacketBuffer[kCHDataPacketType]			= 0x00;
-	
 	Serial3.begin(kXBusBaudrate);
 	Serial3.setTimeout(300);
+	xbusSerial = &Serial3;
+	setTxUSART(3);
 
 	return kXBusError_NoError;
 }
@@ -1074,12 +2529,11 @@ XBusError XBusServoEx::begin3(void)
 void XBusServoEx::end3(void)
 {
 	Serial3.end();
+	xbusSerial = NULL;
+	setTxUSART(-1);
 	pinMode(this->dirPinNo, INPUT);
 
-	if (chPacketBuffer != NULL)
-		free(chPacketBuffer);
-	if (sendBuffer != NULL)
-		free(sendBuffer);
+	freeBuffers();
 }
 
 
@@ -1095,139 +2549,13 @@ void XBusServoEx::end3(void)
 //****************************************************************************
 void XBusServoEx::sendChannelDataPacket3(void)
 {
-	if (modifyServosNow)
-		return;
-	
-	if (numOfServo > 0)
-	{
-		if (dirty)
-		{
-			memcpy(sendBuffer, chPacketBuffer, chPacketBuffer[kCHDataPacketLength] + 3);
-			dirty = 0;
-		}
-		
-		Serial3.write(sendBuffer, sendBuffer[kCHDataPacketLength] + 3);
-	}
-}
-
-//****************************************************************************
-//	XBusServoEx::sendCommandDataPacket3
-//		return :	error code
-//		parameter :	command		The commnad that you want to send
-//					channelID	The channel ID of the XBus servo that you want to set up
-//					order		The order that you want to set up
-//					value		The value that you want to set / get
-//					valueSize	The value size.  1 byte(char) or 2 byte(int)
-//
-//		This should NOT be called on the timer handler like MsTimer2 when you
-//		setup the XBus servo.
-//		2014/05/14 : add header by Sawa
-// 		2023/11/26 : added by Izumi Ninagawa
-//****************************************************************************
-XBusError XBusServoEx::sendCommandDataPacket3(char command, char channelID, char order, int* value, char valueSize)
-{
-	int					sendSize;
-	int					recieveSize;
-	
-	// setup command
-	sendBuffer[kCmdDataPacketCommand] = command;
-	sendBuffer[kCmdDataPacketLength] = valueSize + 3;
-	sendBuffer[kCmdDataPacketKey] = 0x00;
-	sendBuffer[kCmdDataPacketCH_ID] = channelID;
-	sendBuffer[kCmdDataPacketOrder] = order;
-	if (valueSize == 1)						// 1 byte value
-	{
-		sendBuffer[kCmdDataPacketData1] = *value & 0x00FF;
-		sendBuffer[kCmdDataPacketData2] = crc8(sendBuffer, sendBuffer[kCHDataPacketLength] + 2);
-	}
-	else
-	{
-		sendBuffer[kCmdDataPacketData1] = (*value >> 8) & 0x00FF;
-		sendBuffer[kCmdDataPacketData2] = *value & 0x00FF;		
-		sendBuffer[kCmdDataPacketCRC] = crc8(sendBuffer, sendBuffer[kCHDataPacketLength] + 2);
-	}
-	
-	// to recover channel data packet when you call sendChannelDataPacket after this
-	dirty = 1;
-
-	// send command
-	sendSize = sendBuffer[kCmdDataPacketLength] + 3;
-	while(Serial3.read() >= 0)
-		;																				// flush the receive buffer
-	Serial3.write(sendBuffer, sendSize);
-	Serial3.flush();														// wait to send all bytes
-
-	// change bus direction to Rx mode
-	if (dirPinNo >= 0)
-		digitalWrite(dirPinNo, HIGH);
-	
-	if (channelID != 0)
-	{
-		// dummy read for sent packet
-		recieveSize = Serial3.readBytes((char*)sendBuffer, sendSize);
-		if (recieveSize == 0)
-		{
-		// change bus direction to Tx mode
-			if (dirPinNo >= 0)
-				digitalWrite(dirPinNo, LOW);
-			return kXBusError_TimeOut;
-		}
-
-		// read packet
-		recieveSize = Serial3.readBytes((char*)sendBuffer, 2);
-		if (recieveSize == 0)
-		{
-		// change bus direction to Tx mode
-			if (dirPinNo >= 0)
-				digitalWrite(dirPinNo, LOW);
-			return kXBusError_TimeOut;
-		}
-		
-		Serial3.readBytes((char*)&(sendBuffer[kCmdDataPacketKey]), sendBuffer[kCHDataPacketLength] + 1);
-		if (recieveSize == 0)
-		{
-		// change bus direction to Tx mode
-			if (dirPinNo >= 0)
-				digitalWrite(dirPinNo, LOW);
-			return kXBusError_TimeOut;
-		}
-
-		// change bus direction to Tx mode
-		if (dirPinNo >= 0)
-			digitalWrite(dirPinNo, LOW);
-
-		// check CRC
-		if (crc8(sendBuffer, sendBuffer[kCHDataPacketLength] + 3) != 0)
-			return kXBusError_CRCError;
-
-		// check unsupported
-		if (sendBuffer[kCmdDataPacketOrder] == kXBusOrder_1_Unsupported)
-			return kXBusError_Unsupported;
-
-		// send bcak the value
-		if (valueSize == 1)						// 1 byte value
-		{
-			*value = sendBuffer[kCmdDataPacketData1];
-			if (*value & 0x0080)
-				*value |= 0xFF00;
-		}
-		else
-		{
-			*value = sendBuffer[kCmdDataPacketData1];
-			*value <<= 8;
-			*value |= sendBuffer[kCmdDataPacketData2];		
-		}
+	int		sendSize;
 
-		return kXBusError_NoError;
-	}
-	else
-	{
-		// change bus direction to Tx mode
-		if (dirPinNo >= 0)
-			digitalWrite(dirPinNo, LOW);
-		return kXBusError_NoError;
-	}
+	sendSize = prepareChannelDataPacket();
+	if (sendSize > 0)
+		Serial3.write(sendBuffer, sendSize);
 }
+
 #endif
 
 
@@ -1247,29 +2575,16 @@ XBusError XBusServoEx::sendCommandDataPacket3(char command, char channelID, char
 //****************************************************************************
 XBusError XBusServoEx::begin4(void)
 {
-	int				bufferSize;						// channel data packet buffer size
+	XBusError		result;
 
-	bufferSize = kStartOffsetOfCHData + maxServo * kCHDataSize + 1;		// add 1 for CRC
-	if (bufferSize < kCmdDataPacketSize)
-		bufferSize = kCmdDataPacketSize;
-	chPacketBuffer = (uint8_t*)malloc(bufferSize);
-	if (chPacketBuffer == NULL)
-		return kXBusError_MemoryFull;
-	sendBuffer = (uint8_t*)malloc(bufferSize);
-	if (sendBuffer == NULL)
-	{
-		free(chPacketBuffer);
-		return kXBusError_MemoryFull;
-	}
+	result = allocBuffers();
+	if (result != kXBusError_NoError)
+		return result;
 
-	// initialize channel packer buffer
-	chPacketBuffer[kCHDataPacketCommand]	= kXBusCmd_ModeA;
-	chPacketBuffer[kCHDataPacketLength]		= 0x00;
-	chPacketBuffer[kCHDataPacketKey]			= 0x00;
-	chPacketBuffer[kCHDataPacketType]			= 0x00;
-	
 	Serial4.begin(kXBusBaudrate);
 	Serial4.setTimeout(300);
+	xbusSerial = &Serial4;
+	setTxUSART(-1);
 
 	return kXBusError_NoError;
 }
@@ -1288,29 +2603,16 @@ XBusError XBusServoEx::begin4(void)
 //****************************************************************************
 XBusError XBusServoEx::begin5(void)
 {
-	int				bufferSize;						// channel data packet buffer size
+	XBusError		result;
 
-	bufferSize = kStartOffsetOfCHData + maxServo * kCHDataSize + 1;		// add 1 for CRC
-	if (bufferSize < kCmdDataPacketSize)
-		bufferSize = kCmdDataPacketSize;
-	chPacketBuffer = (uint8_t*)malloc(bufferSize);
-	if (chPacketBuffer == NULL)
-		return kXBusError_MemoryFull;
-	sendBuffer = (uint8_t*)malloc(bufferSize);
-	if (sendBuffer == NULL)
-	{
-		free(chPacketBuffer);
-		return kXBusError_MemoryFull;
-	}
+	result = allocBuffers();
+	if (result != kXBusError_NoError)
+		return result;
 
-	// initialize channel packer buffer
-	chPacketBuffer[kCHDataPacketCommand]	= kXBusCmd_ModeA;
-	chPacketBuffer[kCHDataPacketLength]		= 0x00;
-	chPacketBuffer[kCHDataPacketKey]			= 0x00;
-	chPacketBuffer[kCHDataPacketType]			= 0x00;
-	
 	Serial5.begin(kXBusBaudrate);
 	Serial5.setTimeout(300);
+	xbusSerial = &Serial5;
+	setTxUSART(-1);
 
 	return kXBusError_NoError;
 }
@@ -1329,12 +2631,11 @@ XBusError XBusServoEx::begin5(void)
 void XBusServoEx::end4(void)
 {
 	Serial4.end();
+	xbusSerial = NULL;
+	setTxUSART(-1);
 	pinMode(this->dirPinNo, INPUT);
 
-	if (chPacketBuffer != NULL)
-		free(chPacketBuffer);
-	if (sendBuffer != NULL)
-		free(sendBuffer);
+	freeBuffers();
 }
 
 //****************************************************************************
@@ -1350,12 +2651,11 @@ void XBusServoEx::end4(void)
 void XBusServoEx::end5(void)
 {
 	Serial5.end();
+	xbusSerial = NULL;
+	setTxUSART(-1);
 	pinMode(this->dirPinNo, INPUT);
 
-	if (chPacketBuffer != NULL)
-		free(chPacketBuffer);
-	if (sendBuffer != NULL)
-		free(sendBuffer);
+	freeBuffers();
 }
 
 //****************************************************************************
@@ -1370,19 +2670,11 @@ void XBusServoEx::end5(void)
 //****************************************************************************
 void XBusServoEx::sendChannelDataPacket4(void)
 {
-	if (modifyServosNow)
-		return;
-	
-	if (numOfServo > 0)
-	{
-		if (dirty)
-		{
-			memcpy(sendBuffer, chPacketBuffer, chPacketBuffer[kCHDataPacketLength] + 3);
-			dirty = 0;
-		}
-		
-		Serial4.write(sendBuffer, sendBuffer[kCHDataPacketLength] + 3);
-	}
+	int		sendSize;
+
+	sendSize = prepareChannelDataPacket();
+	if (sendSize > 0)
+		Serial4.write(sendBuffer, sendSize);
 }
 
 //****************************************************************************
@@ -1397,259 +2689,13 @@ void XBusServoEx::sendChannelDataPacket4(void)
 //****************************************************************************
 void XBusServoEx::sendChannelDataPacket5(void)
 {
-	if (modifyServosNow)
-		return;
-	
-	if (numOfServo > 0)
-	{
-		if (dirty)
-		{
-			memcpy(sendBuffer, chPacketBuffer, chPacketBuffer[kCHDataPacketLength] + 3);
-			dirty = 0;
-		}
-		
-		Serial5.write(sendBuffer, sendBuffer[kCHDataPacketLength] + 3);
-	}
-}
-
-//****************************************************************************
-//	XBusServoEx::sendCommandDataPacket4
-//		return :	error code
-//		parameter :	command		The commnad that you want to send
-//					channelID	The channel ID of the XBus servo that you want to set up
-//					order		The order that you want to set up
-//					value		The value that you want to set / get
-//					valueSize	The value size.  1 byte(char) or 2 byte(int)
-//
-//		This should NOT be called on the timer handler like MsTimer2 when you
-//		setup the XBus servo.
-//		2014/05/14 : add header by Sawa
-// 		2023/11/26 : added by Izumi Ninagawa
-//****************************************************************************
-XBusError XBusServoEx::sendCommandDataPacket4(char command, char channelID, char order, int* value, char valueSize)
-{
-	int					sendSize;
-	int					recieveSize;
-	
-	// setup command
-	sendBuffer[kCmdDataPacketCommand] = command;
-	sendBuffer[kCmdDataPacketLength] = valueSize + 3;
-	sendBuffer[kCmdDataPacketKey] = 0x00;
-	sendBuffer[kCmdDataPacketCH_ID] = channelID;
-	sendBuffer[kCmdDataPacketOrder] = order;
-	if (valueSize == 1)						// 1 byte value
-	{
-		sendBuffer[kCmdDataPacketData1] = *value & 0x00FF;
-		sendBuffer[kCmdDataPacketData2] = crc8(sendBuffer, sendBuffer[kCHDataPacketLength] + 2);
-	}
-	else
-	{
-		sendBuffer[kCmdDataPacketData1] = (*value >> 8) & 0x00FF;
-		sendBuffer[kCmdDataPacketData2] = *value & 0x00FF;		
-		sendBuffer[kCmdDataPacketCRC] = crc8(sendBuffer, sendBuffer[kCHDataPacketLength] + 2);
-	}
-	
-	// to recover channel data packet when you call sendChannelDataPacket after this
-	dirty = 1;
-
-	// send command
-	sendSize = sendBuffer[kCmdDataPacketLength] + 3;
-	while(Serial4.read() >= 0)
-		;																				// flush the receive buffer
-	Serial4.write(sendBuffer, sendSize);
-	Serial4.flush();														// wait to send all bytes
-
-	// change bus direction to Rx mode
-	if (dirPinNo >= 0)
-		digitalWrite(dirPinNo, HIGH);
-	
-	if (channelID != 0)
-	{
-		// dummy read for sent packet
-		recieveSize = Serial4.readBytes((char*)sendBuffer, sendSize);
-		if (recieveSize == 0)
-		{
-		// change bus direction to Tx mode
-			if (dirPinNo >= 0)
-				digitalWrite(dirPinNo, LOW);
-			return kXBusError_TimeOut;
-		}
-
-		// read packet
-		recieveSize = Serial4.readBytes((char*)sendBuffer, 2);
-		if (recieveSize == 0)
-		{
-		// change bus direction to Tx mode
-			if (dirPinNo >= 0)
-				digitalWrite(dirPinNo, LOW);
-			return kXBusError_TimeOut;
-		}
-		
-		Serial4.readBytes((char*)&(sendBuffer[kCmdDataPacketKey]), sendBuffer[kCHDataPacketLength] + 1);
-		if (recieveSize == 0)
-		{
-		// change bus direction to Tx mode
-			if (dirPinNo >= 0)
-				digitalWrite(dirPinNo, LOW);
-			return kXBusError_TimeOut;
-		}
-
-		// change bus direction to Tx mode
-		if (dirPinNo >= 0)
-			digitalWrite(dirPinNo, LOW);
-
-		// check CRC
-		if (crc8(sendBuffer, sendBuffer[kCHDataPacketLength] + 3) != 0)
-			return kXBusError_CRCError;
-
-		// check unsupported
-		if (sendBuffer[kCmdDataPacketOrder] == kXBusOrder_1_Unsupported)
-			return kXBusError_Unsupported;
-
-		// send bcak the value
-		if (valueSize == 1)						// 1 byte value
-		{
-			*value = sendBuffer[kCmdDataPacketData1];
-			if (*value & 0x0080)
-				*value |= 0xFF00;
-		}
-		else
-		{
-			*value = sendBuffer[kCmdDataPacketData1];
-			*value <<= 8;
-			*value |= sendBuffer[kCmdDataPacketData2];		
-		}
+	int		sendSize;
 
-		return kXBusError_NoError;
-	}
-	else
-	{
-		// change bus direction to Tx mode
-		if (dirPinNo >= 0)
-			digitalWrite(dirPinNo, LOW);
-		return kXBusError_NoError;
-	}
+	sendSize = prepareChannelDataPacket();
+	if (sendSize > 0)
+		Serial5.write(sendBuffer, sendSize);
 }
 
-
-//****************************************************************************
-//	XBusServoEx::sendCommandDataPacket5
-//		return :	error code
-//		parameter :	command		The commnad that you want to send
-//					channelID	The channel ID of the XBus servo that you want to set up
-//					order		The order that you want to set up
-//					value		The value that you want to set / get
-//					valueSize	The value size.  1 byte(char) or 2 byte(int)
-//
-//		This should NOT be called on the timer handler like MsTimer2 when you
-//		setup the XBus servo.
-//		2014/05/14 : add header by Sawa
-// 		2023/11/26 : added by Izumi Ninagawa
-//****************************************************************************
-XBusError XBusServoEx::sendCommandDataPacket5(char command, char channelID, char order, int* value, char valueSize)
-{
-	int					sendSize;
-	int					recieveSize;
-	
-	// setup command
-	sendBuffer[kCmdDataPacketCommand] = command;
-	sendBuffer[kCmdDataPacketLength] = valueSize + 3;
-	sendBuffer[kCmdDataPacketKey] = 0x00;
-	sendBuffer[kCmdDataPacketCH_ID] = channelID;
-	sendBuffer[kCmdDataPacketOrder] = order;
-	if (valueSize == 1)						// 1 byte value
-	{
-		sendBuffer[kCmdDataPacketData1] = *value & 0x00FF;
-		sendBuffer[kCmdDataPacketData2] = crc8(sendBuffer, sendBuffer[kCHDataPacketLength] + 2);
-	}
-	else
-	{
-		sendBuffer[kCmdDataPacketData1] = (*value >> 8) & 0x00FF;
-		sendBuffer[kCmdDataPacketData2] = *value & 0x00FF;		
-		sendBuffer[kCmdDataPacketCRC] = crc8(sendBuffer, sendBuffer[kCHDataPacketLength] + 2);
-	}
-	
-	// to recover channel data packet when you call sendChannelDataPacket after this
-	dirty = 1;
-
-	// send command
-	sendSize = sendBuffer[kCmdDataPacketLength] + 3;
-	while(Serial5.read() >= 0)
-		;																				// flush the receive buffer
-	Serial5.write(sendBuffer, sendSize);
-	Serial5.flush();														// wait to send all bytes
-
-	// change bus direction to Rx mode
-	if (dirPinNo >= 0)
-		digitalWrite(dirPinNo, HIGH);
-	
-	if (channelID != 0)
-	{
-		// dummy read for sent packet
-		recieveSize = Serial5.readBytes((char*)sendBuffer, sendSize);
-		if (recieveSize == 0)
-		{
-		// change bus direction to Tx mode
-			if (dirPinNo >= 0)
-				digitalWrite(dirPinNo, LOW);
-			return kXBusError_TimeOut;
-		}
-
-		// read packet
-		recieveSize = Serial5.readBytes((char*)sendBuffer, 2);
-		if (recieveSize == 0)
-		{
-		// change bus direction to Tx mode
-			if (dirPinNo >= 0)
-				digitalWrite(dirPinNo, LOW);
-			return kXBusError_TimeOut;
-		}
-		
-		Serial5.readBytes((char*)&(sendBuffer[kCmdDataPacketKey]), sendBuffer[kCHDataPacketLength] + 1);
-		if (recieveSize == 0)
-		{
-		// change bus direction to Tx mode
-			if (dirPinNo >= 0)
-				digitalWrite(dirPinNo, LOW);
-			return kXBusError_TimeOut;
-		}
-
-		// change bus direction to Tx mode
-		if (dirPinNo >= 0)
-			digitalWrite(dirPinNo, LOW);
-
-		// check CRC
-		if (crc8(sendBuffer, sendBuffer[kCHDataPacketLength] + 3) != 0)
-			return kXBusError_CRCError;
-
-		// check unsupported
-		if (sendBuffer[kCmdDataPacketOrder] == kXBusOrder_1_Unsupported)
-			return kXBusError_Unsupported;
-
-		// send bcak the value
-		if (valueSize == 1)						// 1 byte value
-		{
-			*value = sendBuffer[kCmdDataPacketData1];
-			if (*value & 0x0080)
-				*value |= 0xFF00;
-		}
-		else
-		{
-			*value = sendBuffer[kCmdDataPacketData1];
-			*value <<= 8;
-			*value |= sendBuffer[kCmdDataPacketData2];		
-		}
-
-		return kXBusError_NoError;
-	}
-	else
-	{
-		// change bus direction to Tx mode
-		if (dirPinNo >= 0)
-			digitalWrite(dirPinNo, LOW);
-		return kXBusError_NoError;
-	}
-}
 #endif
 
 
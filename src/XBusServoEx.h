@@ -10,16 +10,93 @@
 #ifndef XBusServoEx_h
 #define XBusServoEx_h
 #include "arduino.h"
+#include "XBusRxParser.h"
 
+class XBusRecordRing;
+
+#define	kXBusBaudrate				250000			// bps
+#define	kXBusByteTime				(10 * 1000000L / kXBusBaudrate)	// uSec for 1 byte (8N1)
 #define	kXBusInterval				14				// mSec
+#define	kXBusResponseGap			200				// uSec.  bus turnaround and servo response delay
 #define	kXbusServo900uSec			0x1249			// 900uSec
 #define	kXbusServoNeutral			0x7FFF			// 1500uSec
 #define	kXbusServo2100uSec			0xEDB6			// 2100uSec
 #define	kXBusMaxServoNum			50				// from 1 to 50
 #define	kXBusMaxServoSubID			3				// from 0 to 3
 #define	kXBusServoProductIDBase		0x0200
+#define	kXBusCmdPacketMaxSize		8				// command packet with 2 bytes value
+#define	kXBusMaxPacketSize			(4 + kXBusMaxServoNum * 4 + 1)	// channel data packet with max servos
+#define	kXBusCalMinPoints			3				// points of the calibration table.  2^n + 1
+#define	kXBusCalMaxPoints			65
+#define	kXBusCalProgmem				0x80			// the calibration table is in PROGMEM
+#define	kXBusVirtualNone			0xFF			// the servo is not linked to the virtual channel
+#define	kXBusVirtualScaleOne		4096			// scale 1.0 of the virtual channel target
+
+#define	kXbusServoMinUSec			800				// raw value 0x0000
+#define	kXbusServoMaxUSec			2200			// raw value 0xFFFF
+#define	kXbusServoNeutralUSec		1500
+#define	kXbusServoMaxDeciDeg		700				// 0.1 degree unit at kXbusServoMaxUSec in normal mode
+#define	kXbusServoMaxDeciDeg180		1050			// 0.1 degree unit at kXbusServoMaxUSec in 180 degree mode
+
+
+
+// memory barrier for the data shared with the interrupt handler or the other core.
+// XBusSeq is the sequence counter which can be read and written atomically
+#if defined(__AVR__)
+#define	XBUS_MEMORY_BARRIER()		asm volatile("" ::: "memory")
+typedef uint8_t		XBusSeq;
+#else
+#define	XBUS_MEMORY_BARRIER()		__sync_synchronize()
+typedef uint32_t	XBusSeq;
+#endif
+#define	kXBusSeqRetry				3				// retry to copy the channel data modified on the other core
+
 
 
+// unit conversion
+//	raw value is linear to the pulse width (800uSec = 0x0000, 2200uSec = 0xFFFF).
+//	the results for 900uSec, 1500uSec and 2100uSec are exactly kXbusServo900uSec,
+//	kXbusServoNeutral and kXbusServo2100uSec.
+//	angle is in 0.1 degree unit.  nominal travel from 900 to 2100uSec is +-60 degree
+//	in normal mode and +-90 degree in 180 degree mode (kXBusOrder_1_Angle_180).
+//	all of them are integer only and constexpr, so constants are converted at compile time.
+constexpr unsigned int XBusUSecToRaw(long uSec)
+{
+	return (uSec <= kXbusServoMinUSec) ? 0x0000
+			: (uSec >= kXbusServoMaxUSec) ? 0xFFFF
+			: (unsigned int)(kXbusServoNeutral + (((uSec - kXbusServoNeutralUSec) * 191737L + 3072) >> 12));
+}
+
+constexpr int XBusRawToUSec(unsigned int raw)
+{
+	return (int)(kXbusServoNeutralUSec + ((((long)raw - kXbusServoNeutral) * 1400L + 2048) >> 16));
+}
+
+constexpr unsigned int XBusDeciDegToRaw(long deciDeg, bool angle180)
+{
+	return (! angle180) ? XBusUSecToRaw(kXbusServoNeutralUSec + deciDeg)
+			: (deciDeg <= -kXbusServoMaxDeciDeg180) ? 0x0000
+			: (deciDeg >= kXbusServoMaxDeciDeg180) ? 0xFFFF
+			: (unsigned int)(kXbusServoNeutral + ((deciDeg * 127825L + 3072) >> 12));
+}
+
+constexpr int XBusRawToDeciDeg(unsigned int raw, bool angle180)
+{
+	return (! angle180) ? XBusRawToUSec(raw) - kXbusServoNeutralUSec
+			: (int)((((long)raw - kXbusServoNeutral) * 2100L + 2048) >> 16);
+}
+
+
+
+// XBus Command
+typedef enum
+{
+	kXBusCmd_Set =				0x20,
+	kXBusCmd_Get =				0x21,
+	kXBusCmd_Status =			0x22,
+	kXBusCmd_ModeA =			0xa4
+} XBusCmd;
+
 
 // XBus Get/Set/Status command order
 typedef enum
@@ -83,6 +160,70 @@ typedef enum
 } XBusParamIdx;
 
 
+// XBus order descriptor table
+//	this is the only table of the orders.  XBusOrderDesc<order> has the items at
+//	compile time for get<order>() / set<order>(), and getDataSize() is made from it.
+//	the range is the one of the servo checker
+#define	kXBusAccess_Get				0x01
+#define	kXBusAccess_Set				0x02
+#define	kXBusAccess_GetSet			(kXBusAccess_Get | kXBusAccess_Set)
+
+//	X(order,					size,	signed,	access,				param index,				min,	max)
+#define	XBusOrderTable(X) \
+	X(kXBusOrder_1_Mode,		1,		false,	kXBusAccess_GetSet,	kParamIdx_Unused0,			0,		0xFF) \
+	X(kXBusOrder_1_ID,			1,		false,	kXBusAccess_GetSet,	kParamIdx_ServoID,			1,		0xFF) \
+	X(kXBusOrder_2_Version,		2,		false,	kXBusAccess_Get,	kParamIdx_Unused0,			0,		0xFFFF) \
+	X(kXBusOrder_2_Product,		2,		false,	kXBusAccess_Get,	kParamIdx_Unused0,			0,		0xFFFF) \
+	X(kXBusOrder_2_Reset,		2,		false,	kXBusAccess_Set,	kParamIdx_Unused0,			0,		0xFFFF) \
+	X(kXBusOrder_2_ParamWrite,	2,		false,	kXBusAccess_Set,	kParamIdx_Unused0,			0,		kParamIdx_MaxIntegerDiff) \
+	X(kXBusOrder_2_Reverse,		2,		false,	kXBusAccess_GetSet,	kParamIdx_Reversed,			0,		1) \
+	X(kXBusOrder_2_Neutral,		2,		true,	kXBusAccess_GetSet,	kParamIdx_NeutralOffset,	-300,	300) \
+	X(kXBusOrder_2_H_Travel,	2,		false,	kXBusAccess_GetSet,	kParamIdx_TravelHigh,		0,		192) \
+	X(kXBusOrder_2_L_Travel,	2,		false,	kXBusAccess_GetSet,	kParamIdx_TravelLow,		0,		192) \
+	X(kXBusOrder_2_H_Limit,		2,		false,	kXBusAccess_GetSet,	kParamIdx_LimitHigh,		0,		0xFFFF) \
+	X(kXBusOrder_2_L_Limit,		2,		false,	kXBusAccess_GetSet,	kParamIdx_LimitLow,			0,		0xFFFF) \
+	X(kXBusOrder_1_P_Gain,		1,		true,	kXBusAccess_GetSet,	kParamIdx_PGainDiff,		-50,	50) \
+	X(kXBusOrder_1_I_Gain,		1,		true,	kXBusAccess_GetSet,	kParamIdx_IGainDiff,		-50,	50) \
+	X(kXBusOrder_1_D_Gain,		1,		true,	kXBusAccess_GetSet,	kParamIdx_DGainDiff,		-50,	50) \
+	X(kXBusOrder_1_DeadBand,	1,		true,	kXBusAccess_GetSet,	kParamIdx_DeadBandDiff,		-10,	10) \
+	X(kXBusOrder_2_PowerOffset,	2,		true,	kXBusAccess_GetSet,	kParamIdx_PWOffsetDiff,		-999,	999) \
+	X(kXBusOrder_1_AlarmLevel,	1,		false,	kXBusAccess_GetSet,	kParamIdx_AlarmLevel,		0,		99) \
+	X(kXBusOrder_2_AlarmDelay,	2,		false,	kXBusAccess_GetSet,	kParamIdx_AlarmDelay,		0,		5000) \
+	X(kXBusOrder_1_Angle_180,	1,		false,	kXBusAccess_GetSet,	kParamIdx_Angle_180,		0,		1) \
+	X(kXBusOrder_1_SlowStart,	1,		false,	kXBusAccess_GetSet,	kParamIdx_SlowStart,		0,		1) \
+	X(kXBusOrder_1_StopMode,	1,		false,	kXBusAccess_GetSet,	kParamIdx_StopMode,			0,		1) \
+	X(kXBusOrder_2_CurrentPos,	2,		false,	kXBusAccess_Get,	kParamIdx_Unused0,			0,		0xFFFF) \
+	X(kXBusOrder_1_CurrentPow,	1,		false,	kXBusAccess_Get,	kParamIdx_Unused0,			0,		0xFF) \
+	X(kXBusOrder_1_SpeedLimit,	1,		false,	kXBusAccess_GetSet,	kParamIdx_SpeedLimit,		0,		30) \
+	X(kXBusOrder_2_MaxInteger,	2,		true,	kXBusAccess_GetSet,	kParamIdx_MaxIntegerDiff,	-999,	999)
+
+// value type of the order
+template <int size, bool isSigned> struct XBusOrderValue;
+template <> struct XBusOrderValue<1, false>	{ typedef uint8_t	Type; };
+template <> struct XBusOrderValue<1, true>	{ typedef int8_t	Type; };
+template <> struct XBusOrderValue<2, false>	{ typedef uint16_t	Type; };
+template <> struct XBusOrderValue<2, true>	{ typedef int16_t	Type; };
+
+// XBusOrderDesc<order> is not defined for the order not in the table,
+// so get<order>() / set<order>() of such order does not compile
+template <XBusOrder order> struct XBusOrderDesc;
+
+#define	XBusOrderDescItem(order, dataSize, dataSigned, access, index, low, high) \
+	template <> struct XBusOrderDesc<order> \
+	{ \
+		static constexpr uint8_t	size = dataSize; \
+		static constexpr bool		isSigned = dataSigned; \
+		static constexpr bool		canGet = ((access) & kXBusAccess_Get) != 0; \
+		static constexpr bool		canSet = ((access) & kXBusAccess_Set) != 0; \
+		static constexpr uint8_t	paramIndex = index; \
+		static constexpr long		minValue = low; \
+		static constexpr long		maxValue = high; \
+		typedef XBusOrderValue<dataSize, dataSigned>::Type	Type; \
+	};
+XBusOrderTable(XBusOrderDescItem)
+#undef	XBusOrderDescItem
+
+
 // XBus error code
 typedef enum
 {
@@ -97,11 +238,49 @@ typedef enum
 	kXBusError_OnlyForNormalMode,
 	kXBusError_MemoryFull,
 	kXBusError_TimeOut,
+	kXBusError_BusBusy,
+	kXBusError_Pending,							// waiting the response.  not an error
+	kXBusError_EchoError,						// the echo of the command is different or does not come
+	kXBusError_OutOfRange,						// the value is out of the range of the order
 
 	kXBusError_NumOfError,
 } XBusError;
 
 
+// admission control of the commands
+typedef enum
+{
+	kXBusAdmission_Off =			0x00,		// send commands at any time
+	kXBusAdmission_Reject,						// return kXBusError_BusBusy if it delays the next channel packet
+	kXBusAdmission_Defer,						// wait for the next channel packet if it delays that
+} XBusAdmission;
+
+
+// error statistics of each servo
+// response latency histogram.  bin n counts the responses within (1 << n) mSec,
+// and the last bin counts the slower ones
+#define	kXBusLatencyBins			8
+
+typedef struct
+{
+	unsigned int		crcErrors;
+	unsigned int		timeouts;
+	unsigned int		retries;
+	unsigned int		echoErrors;
+	unsigned int		commands;					// commands sent to the servo including the retries
+	unsigned int		latency[kXBusLatencyBins];	// uSec from sending the command to the end of the response
+} XBusServoStats;
+
+typedef enum
+{
+	kXBusStats_CRCError,
+	kXBusStats_TimeOut,
+	kXBusStats_Retry,
+	kXBusStats_EchoError,
+	kXBusStats_Command,
+} XBusStatsItem;
+
+
 // XBus servo models
 #define kServo_NX8921				0x0200
 #define kServo_NX3421				0x0201
@@ -140,6 +319,23 @@ class XBusServoEx
 			XBusError		addServo(char channelID, unsigned int initValue);
 			XBusError		removeServo(char channelID);
 			XBusError		setServo(char channelID, unsigned int value);
+			XBusError		setServoByIndex(int servoNo, unsigned int value);
+			XBusError		setServosByIndex(int servoNo, int count, const uint8_t* values);
+			unsigned int	getServoByIndex(int servoNo);
+			int				getNumOfServo(void);
+			char			getServoID(int servoNo);
+			XBusError		setServoLimit(char channelID, unsigned int maxStep, unsigned int maxAccel);
+			XBusError		setPartialFrame(unsigned int refreshFrames);
+			XBusError		setServoRate(char channelID, unsigned char divider);
+			XBusError		setServoCalibration(char channelID, const uint16_t* table, uint8_t numOfPoints);
+			XBusError		setServoCalibration_P(char channelID, const uint16_t* table, uint8_t numOfPoints);
+			XBusError		setVirtualTarget(uint8_t virtualNo, char channelID, char reverse, int offset, int scale);
+			XBusError		setVirtual(uint8_t virtualNo, unsigned int value);
+
+			unsigned long	getChannelFrameTime(int servoNum);
+			unsigned long	getCommandTime(char channelID, char order);
+			unsigned int	getBusLoad(int numOfCommand);
+			void			setAdmissionControl(XBusAdmission mode, unsigned long intervalUSec);
 		
 			void	sendChannelDataPacket(void);
 			void	sendChannelDataPacket1(void);
@@ -155,26 +351,133 @@ class XBusServoEx
 			XBusError		setChannelID(char newChannelID);
 			XBusError		setCommand(char order, int* value);
 
+			// typed command.  the size and the sign of the value come from
+			// XBusOrderDesc<order> at compile time.  set returns
+			// kXBusError_OutOfRange without sending for the value out of its range
+			//	int16_t neutral;
+			//	myXBusServo.get<kXBusOrder_2_Neutral>(0x01, &neutral);
+			//	myXBusServo.set<kXBusOrder_1_SpeedLimit>(0x01, 10);
+			template <XBusOrder order>
+			XBusError		get(char channelID, typename XBusOrderDesc<order>::Type* value)
+							{
+								static_assert(XBusOrderDesc<order>::canGet, "the order is only for set");
+								int			data = 0;
+								XBusError	result;
+
+								result = sendCommandDataPacket(kXBusCmd_Get, channelID, order, &data, XBusOrderDesc<order>::size);
+								if (result == kXBusError_NoError)
+									*value = (typename XBusOrderDesc<order>::Type)data;		// sign by the type
+								return result;
+							}
+
+			template <XBusOrder order>
+			XBusError		set(char channelID, typename XBusOrderDesc<order>::Type value)
+							{
+								static_assert(XBusOrderDesc<order>::canSet, "the order is only for get");
+								long		range = value;
+								int			data = value;
+
+								if ((range < XBusOrderDesc<order>::minValue) || (range > XBusOrderDesc<order>::maxValue))
+									return kXBusError_OutOfRange;
+								return sendCommandDataPacket(kXBusCmd_Set, channelID, order, &data, XBusOrderDesc<order>::size);
+							}
+
+			XBusError		startSetCommand(char channelID, char order, int value, unsigned long timeOutUSec = 0);
+			XBusError		startGetCommand(char channelID, char order, unsigned long timeOutUSec = 0);
+			XBusError		pollCommand(int* value);
+
+			void			setRetryPolicy(unsigned char maxAttempts, unsigned char backoffFrames);
+			void			setCommandTimeOut(unsigned long timeOutUSec);
+			unsigned long	getCommandTimeOut(void);
+			XBusError		enableServoStats(void);
+			XBusError		getServoStats(char channelID, XBusServoStats* stats);
+			void			setTraceRecorder(XBusRecordRing* recorder);
+
+			static uint8_t	crc_table(uint8_t data, uint8_t crc);
+			static uint8_t	crc8(uint8_t * buffer, uint8_t length);
+
 		
 		private:
     		int				dirPinNo ;    				// pin number for XBus direction change.  if -1, no dir pin there
+			volatile uint8_t*	dirPort;				// port register of dirPinNo on AVR.  NULL to use digitalWrite
+			uint8_t			dirMask;					// bit of dirPinNo in dirPort
+			volatile uint8_t*	txUCSRB;				// UCSRnB of the USART to use the TX complete interrupt.  NULL if not used
+			uint8_t			txcieBit;
+			int				txUSARTNo;
 			int				numOfServo;						// number of servos
 			unsigned int	maxServo;							// max number of servos
 			uint8_t*		chPacketBuffer;				// channel data packet buffer
 			uint8_t*		sendBuffer;						// serial send buffer
-			char			dirty;
-			volatile char	modifyServosNow;			// 
+			volatile XBusSeq	servoSeq;				// odd while the channel data is modified
+			XBusSeq			builtSeq;					// servoSeq of the packet in sendBuffer.  odd if broken
+			int				builtSize;					// size of the packet in sendBuffer
+			uint16_t*		slewValue;					// output value of each servo for the slew rate limiter
+			long*			slewStep;					// move in the last frame
+			uint16_t*		slewMaxStep;				// max move in one frame.  0 for no limit
+			uint16_t*		slewMaxAccel;				// max change of the move in one frame.  0 for no limit
+			char			slewing;					// 1 while some servos are moving to the target
+			uint16_t*		sentValue;					// value sent last for the partial frame.  NULL to send all
+			unsigned int	partialRefresh;				// frames to send all servos
+			unsigned int	partialCount;				// frame count from the last full frame
+			uint8_t*		rateDivider;				// rate class of each servo.  NULL to send all in every frame
+			const uint16_t**	calTable;				// calibration table of each servo.  NULL if not calibrated
+			uint8_t*		calShift;					// bits of the position in a segment | kXBusCalProgmem
+			uint16_t*		virtualValue;				// value of each virtual channel.  NULL if not used
+			int16_t*		virtualScale;				// scale of each servo linked (kXBusVirtualScaleOne = 1.0).  negative to reverse
+			int16_t*		virtualOffset;				// offset of each servo linked
+			uint8_t*		virtualSource;				// virtual channel of each servo.  kXBusVirtualNone if not linked
+			uint8_t			subFrameCount;				// frame count for the rate class
+			XBusAdmission	admissionMode;
+			unsigned long	frameInterval;				// uSec between the channel data packets
+			volatile unsigned long	frameStartTime;		// micros() at the last channel data packet
+			volatile unsigned int	frameCount;			// number of channel data packets
+			volatile int	lastFrameSize;				// bytes of the last channel data packet
+			Stream*			xbusSerial;					// serial port selected by begin() to begin5()
+			uint8_t			cmdBuffer[kXBusCmdPacketMaxSize];	// command packet to send
+			uint8_t			rxBuffer[kXBusCmdPacketMaxSize];	// response packet
+			XBusRxParser	rxParser;
+			volatile char	commandBusy;				// 1 while waiting the response
+			char			cmdValueSize;
+			int				cmdEchoRemain;				// bytes of the echo to skip
+			unsigned int	cmdCRCErrors;				// CRC error count of rxParser at the start
+			unsigned long	cmdTimeOut;					// uSec from sending the command to the timeout.  0 for the response window
+			unsigned long	cmdWaitTime;				// uSec from sending the command to the timeout of this command
+			unsigned long	cmdSendTime;				// micros() when the command is written to the port
+			XBusError		cmdResult;
+			unsigned char	retryMaxAttempts;
+			unsigned char	retryBackoffFrames;
+			XBusServoStats*	servoStats;					// NULL if not enabled.  the last one is for the servos not added
+			XBusRecordRing*	traceRecorder;				// NULL if not recording
 
-			uint8_t			crc_table(uint8_t data, uint8_t crc);
-			uint8_t			crc8(uint8_t * buffer, uint8_t length);
 			int				getDataSize(char	order);
+			XBusError		allocBuffers(void);
+			void			freeBuffers(void);
+			int				prepareChannelDataPacket(void);
+			int				buildChannelDataPacket(void);
+			unsigned long	getCommandTime(char channelID, char order, char valueSize);
+			XBusError		waitCommandSlot(char channelID, char valueSize);
+			int				selectChannels(void);
+			int				findServo(char channelID);
+			void			initSlotData(int servoNo, unsigned int value);
+			void			removeSlotData(int servoNo);
+			void			applySlewLimit(void);
+			long			getSlewSpeed(unsigned long distance, long accel, long maxSpeed);
+			XBusError		setCalibration(char channelID, const uint16_t* table, uint8_t numOfPoints, uint8_t flags);
+			void			applyCalibration(void);
+			void			applyVirtualChannels(void);
+			void			beginModify(void);
+			void			setTxUSART(int usartNo);
+			void			setRxDirection(void);
+			void			setTxDirection(void);
+			void			endModify(void);
 
 			XBusError	sendCommandDataPacket(char command, char channelID, char order, int* value, char valueSize);
-			XBusError	sendCommandDataPacket1(char command, char channelID, char order, int* value, char valueSize);
-			XBusError	sendCommandDataPacket2(char command, char channelID, char order, int* value, char valueSize);
-			XBusError	sendCommandDataPacket3(char command, char channelID, char order, int* value, char valueSize);
-			XBusError	sendCommandDataPacket4(char command, char channelID, char order, int* value, char valueSize);
-			XBusError	sendCommandDataPacket5(char command, char channelID, char order, int* value, char valueSize);
+			XBusError	startCommand(char command, char channelID, char order, int value, char valueSize, unsigned long timeOutUSec);
+			XBusError	finishCommand(XBusError result);
+			void		waitFrames(unsigned char frames);
+			void		waitFrameSent(void);
+			void		countServoStats(char channelID, XBusStatsItem item);
+			void		countLatency(char channelID, unsigned long latency);
 
 	};
 
@@ -0,0 +1,153 @@
+/* XBusSniffer.cpp file
+ *
+ * for Arduino
+ *
+ * passive XBus bus sniffer
+ */
+
+#include "XBusSniffer.h"
+
+
+//****************************************************************************
+//	XBusSniffer::XBusSniffer
+//		return :		none
+//		parameter :	ringBuffer	buffer for the captured packets
+//					ringSize	size of ringBuffer.  it must be power of 2
+//
+//		Constructor
+//		2026/10/19 : add sniffer
+//****************************************************************************
+XBusSniffer::XBusSniffer(uint8_t* ringBuffer, unsigned int ringSize)
+	: parser(parserBuffer, sizeof(parserBuffer)), captureRing(ringBuffer, ringSize)
+{
+	port = NULL;
+}
+
+
+//****************************************************************************
+//	XBusSniffer::begin
+//		return :		none
+//		parameter :	port		serial port connected to the bus (RX only)
+//
+//		the port should be opened with kXBusBaudrate by the caller.
+//		nothing is sent to the bus
+//		2026/10/19 : add sniffer
+//****************************************************************************
+void XBusSniffer::begin(Stream& port)
+{
+	this->port = &port;
+	parser.reset();
+}
+
+
+//****************************************************************************
+//	XBusSniffer::poll
+//		return :		none
+//		parameter :	none
+//
+//		feed all bytes in the RX buffer of the port.  call this often enough
+//		not to overflow the RX buffer of the port (64 bytes are 2.5mSec)
+//		2026/10/19 : add sniffer
+//****************************************************************************
+void XBusSniffer::poll(void)
+{
+	unsigned long	time;
+	int				size;
+
+	if (port == NULL)
+		return;
+
+	size = port->available();
+	if (size <= 0)
+		return;
+
+	// the last byte in the RX buffer arrived just now
+	time = micros() - (unsigned long)(size - 1) * kXBusByteTime;
+	while (size-- > 0)
+	{
+		feed(port->read(), time);
+		time += kXBusByteTime;
+	}
+}
+
+
+//****************************************************************************
+//	XBusSniffer::feed
+//		return :		none
+//		parameter :	data		received byte
+//					time		micros() when the byte is received
+//
+//		put one byte to the sniffer.  this can be called from the RX interrupt
+//		instead of poll.  the completed packet is put to the ring buffer
+//		with the time of its first byte.  the packets completed from the bytes
+//		after a broken one are put at once
+//		2026/10/19 : add sniffer
+//		2026/10/19 : put the packets already in the parser
+//****************************************************************************
+void XBusSniffer::feed(uint8_t data, unsigned long time)
+{
+	uint8_t		size;
+	bool		completed;
+
+	for (completed = parser.feed(data); completed; completed = parser.next())
+	{
+		size = parser.packetSize();
+		captureRing.push(kXBusRecord_Sniff, parser.packet(), size,
+							time - (unsigned long)(size + parser.pendingSize() - 1) * kXBusByteTime);
+	}
+}
+
+
+//****************************************************************************
+//	XBusSniffer::read
+//		return :		size of the packet.  0 if no packet, -1 if packet is larger than packetSize
+//		parameter :	packet		buffer to get the packet
+//					packetSize	size of the buffer
+//					time		micros() at the start of the packet.  can be NULL
+//
+//		get one packet from the ring buffer.  the packet too large for the
+//		buffer is removed from the ring buffer
+//		2026/10/19 : add sniffer
+//****************************************************************************
+int XBusSniffer::read(uint8_t* packet, int packetSize, unsigned long* time)
+{
+	return captureRing.read(packet, packetSize, time, NULL);
+}
+
+
+//****************************************************************************
+//	XBusSniffer::dump
+//		return :		bytes written
+//		parameter :	out			destination of the capture records
+//
+//		write all captured packets in the record format of XBusRecordRing
+//		2026/10/19 : add sniffer
+//****************************************************************************
+size_t XBusSniffer::dump(Print& out)
+{
+	return captureRing.dump(out);
+}
+
+
+//****************************************************************************
+//	XBusSniffer::packetCount / overflowCount / crcErrorCount
+//		return :		packets captured / packets lost by the full ring buffer /
+//						packets with CRC error
+//		parameter :	none
+//
+//		2026/10/19 : add sniffer
+//****************************************************************************
+unsigned long XBusSniffer::packetCount(void)
+{
+	return captureRing.recordCount();
+}
+
+unsigned long XBusSniffer::overflowCount(void)
+{
+	return captureRing.overflowCount();
+}
+
+unsigned int XBusSniffer::crcErrorCount(void)
+{
+	return parser.crcErrorCount();
+}
@@ -0,0 +1,40 @@
+/* XBusSniffer.h file
+ *
+ * for Arduino
+ *
+ * passive XBus bus sniffer
+ */
+
+#ifndef XBusSniffer_h
+#define XBusSniffer_h
+#include "XBusRecordRing.h"
+
+// the packets are captured in the ring buffer in the record format of
+// XBusRecordRing with kXBusRecord_Sniff.  extras/xbus_sniff_decode.cpp decodes
+// the dumped data on the host.
+
+
+class XBusSniffer
+	{
+		public:
+			XBusSniffer(uint8_t* ringBuffer, unsigned int ringSize);
+
+		public:
+			void			begin(Stream& port);
+			void			poll(void);
+			void			feed(uint8_t data, unsigned long time);
+			int				read(uint8_t* packet, int packetSize, unsigned long* time);
+			size_t			dump(Print& out);
+			unsigned long	packetCount(void);
+			unsigned long	overflowCount(void);
+			unsigned int	crcErrorCount(void);
+
+		private:
+			Stream*			port;
+			uint8_t			parserBuffer[kXBusMaxPacketSize];
+			XBusRxParser	parser;
+			XBusRecordRing	captureRing;
+	};
+
+
+#endif	// of XBusSniffer_h
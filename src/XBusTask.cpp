@@ -0,0 +1,393 @@
+/* XBusTask.cpp file
+ *
+ * for Arduino (ESP32)
+ *
+ * FreeRTOS task owning the XBus port on ESP32
+ */
+
+#include "XBusTask.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+
+
+//****************************************************************************
+//	XBusTask::XBusTask
+//		return :		none
+//		parameter :	servo		XBusServoEx to drive
+//					serialNo	0 to 2.  the port opened by servo.begin() to begin2()
+//
+//		Constructor
+//		2026/10/19 : add ESP32 bus task
+//****************************************************************************
+XBusTask::XBusTask(XBusServoEx& servo, int serialNo)
+{
+	xbus = &servo;
+	this->serialNo = serialNo;
+	task = NULL;
+	commandQueue = NULL;
+	running = false;
+	stopped = true;
+	poseSeq = 0;
+	maxJitter = 0;
+	memset((void*)slotValue, 0, sizeof(slotValue));
+	memset(taskValue, 0, sizeof(taskValue));
+}
+
+
+//****************************************************************************
+//	XBusTask::begin
+//		return :		error code
+//		parameter :	core		CPU core for the bus task (0 or 1)
+//					priority	priority of the bus task.  higher than the application
+//
+//		start the bus task.  call this after begin() and addServo() of the
+//		XBusServoEx.  after this, only the bus task uses the XBusServoEx, and the
+//		application uses the methods of XBusTask.  (loop() of Arduino runs on
+//		core 1, so core 0 is good for the bus task)
+//		2026/10/19 : add ESP32 bus task
+//****************************************************************************
+XBusError XBusTask::begin(int core, unsigned int priority)
+{
+	if (task != NULL)
+		return kXBusError_BusBusy;
+	if (xbus->getNumOfServo() == 0)
+		return kXBusError_ServoNumIsZero;
+
+	commandQueue = xQueueCreate(kXBusTaskQueueSize, sizeof(Request*));
+	if (commandQueue == NULL)
+		return kXBusError_MemoryFull;
+
+	running = true;
+	stopped = false;
+	if (xTaskCreatePinnedToCore(taskEntry, "XBusTask", kXBusTaskStackSize, this, priority, &task, core) != pdPASS)
+	{
+		running = false;
+		stopped = true;
+		task = NULL;
+		vQueueDelete(commandQueue);
+		commandQueue = NULL;
+		return kXBusError_MemoryFull;
+	}
+
+	return kXBusError_NoError;
+}
+
+
+//****************************************************************************
+//	XBusTask::end
+//		return :		none
+//		parameter :	none
+//
+//		stop the bus task after the frame or the command in progress.
+//		do not call this while the other task waits for a command
+//		2026/10/19 : add ESP32 bus task
+//****************************************************************************
+void XBusTask::end(void)
+{
+	if (task == NULL)
+		return;
+
+	running = false;
+	while (! stopped)
+		vTaskDelay(1);
+	task = NULL;
+
+	if (commandQueue != NULL)
+	{
+		vQueueDelete(commandQueue);
+		commandQueue = NULL;
+	}
+}
+
+
+//****************************************************************************
+//	XBusTask::setServo
+//		return :		error code
+//		parameter :	servoNo		index of the servo in the order it was added (0 origin)
+//					value		value of this XBus servo
+//
+//		write the setpoint to the slot.  it never blocks, and the bus task
+//		sends it with the next frame.  32 bit store is atomic on ESP32
+//		2026/10/19 : add ESP32 bus task
+//****************************************************************************
+XBusError XBusTask::setServo(int servoNo, unsigned int value)
+{
+	if ((servoNo < 0) || (servoNo >= xbus->getNumOfServo()))
+		return kXBusError_IDNotFound;
+
+	slotValue[servoNo] = (value & 0xFFFF) | kXBusTaskSlotSet;
+
+	return kXBusError_NoError;
+}
+
+
+//****************************************************************************
+//	XBusTask::beginPose / endPose
+//		return :		none
+//		parameter :	none
+//
+//		put setServo() calls between them to send the values in the same frame.
+//		the bus task retries a few times while the sequence number is odd or
+//		changed during its copy, and then keeps the last pose, so the writer
+//		never waits and the frame is not delayed
+//		2026/10/19 : add ESP32 bus task
+//****************************************************************************
+void XBusTask::beginPose(void)
+{
+	poseSeq = poseSeq + 1;
+	XBUS_MEMORY_BARRIER();
+}
+
+void XBusTask::endPose(void)
+{
+	XBUS_MEMORY_BARRIER();
+	poseSeq = poseSeq + 1;
+}
+
+
+//****************************************************************************
+//	XBusTask::setCommand / getCommand
+//		return :		error code
+//		parameter :	channelID	channel ID of the XBus servo
+//					order		the order that you want
+//					value		the value to set / the value returned from the servo
+//
+//		the command is sent by the bus task in the gap after the frame.
+//		the calling task waits for the result
+//		2026/10/19 : add ESP32 bus task
+//****************************************************************************
+XBusError XBusTask::setCommand(char channelID, char order, int* value)
+{
+	return request(kXBusCmd_Set, channelID, order, value);
+}
+
+XBusError XBusTask::getCommand(char channelID, char order, int* value)
+{
+	return request(kXBusCmd_Get, channelID, order, value);
+}
+
+
+//****************************************************************************
+//	XBusTask::getMaxJitter
+//		return :		max difference of the frame start from the schedule in uSec
+//		parameter :	none
+//
+//		2026/10/19 : add ESP32 bus task
+//****************************************************************************
+unsigned long XBusTask::getMaxJitter(void)
+{
+	return maxJitter;
+}
+
+
+//****************************************************************************
+//	XBusTask::request
+//		return :		error code
+//		parameter :	command		kXBusCmd_Set or kXBusCmd_Get
+//					channelID	channel ID of the XBus servo
+//					order		the order that you want
+//					value		the value to set / the value returned from the servo
+//
+//		2026/10/19 : add ESP32 bus task
+//****************************************************************************
+XBusError XBusTask::request(char command, char channelID, char order, int* value)
+{
+	Request		req;
+	Request*	reqPointer = &req;
+
+	if ((! running) || (commandQueue == NULL))
+		return kXBusError_Unsupported;
+
+	req.command = command;
+	req.channelID = channelID;
+	req.order = order;
+	req.value = *value;
+	req.result = kXBusError_Pending;
+	req.caller = xTaskGetCurrentTaskHandle();
+
+	if (xQueueSend(commandQueue, &reqPointer, portMAX_DELAY) != pdTRUE)
+		return kXBusError_BusBusy;
+	ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+	*value = req.value;
+	return req.result;
+}
+
+
+//****************************************************************************
+//	XBusTask::taskEntry / run
+//		return :		none
+//		parameter :	param		XBusTask
+//
+//		the bus task.  it sends the frame every kXBusInterval with
+//		vTaskDelayUntil, and a command waiting in the queue after the frame
+//		2026/10/19 : add ESP32 bus task
+//****************************************************************************
+void XBusTask::taskEntry(void* param)
+{
+	((XBusTask*)param)->run();
+}
+
+void XBusTask::run(void)
+{
+	TickType_t		lastWake = xTaskGetTickCount();
+	unsigned long	schedule = 0;
+	unsigned long	frameTime;
+	bool			scheduled = false;
+	Request*		req;
+
+	while (running)
+	{
+		vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(kXBusInterval));
+
+		// jitter from the schedule made at the last frame
+		if (scheduled)
+		{
+			long	jitter = (long)(micros() - schedule);
+
+			if (jitter < 0)
+				jitter = -jitter;
+			if ((unsigned long)jitter > maxJitter)
+				maxJitter = jitter;
+		}
+		schedule = micros() + kXBusInterval * 1000L;
+		scheduled = true;
+
+		loadPose();
+		frameTime = micros();
+		sendFrame();
+
+		if (xQueueReceive(commandQueue, &req, 0) == pdTRUE)
+		{
+			doCommand(req, frameTime);
+
+			// the frames are stopped during the command.  start the schedule again
+			lastWake = xTaskGetTickCount();
+			scheduled = false;
+		}
+	}
+
+	stopped = true;
+	vTaskDelete(NULL);
+}
+
+
+//****************************************************************************
+//	XBusTask::loadPose
+//		return :		none
+//		parameter :	none
+//
+//		copy the slots to XBusServoEx.  only the bus task touches XBusServoEx,
+//		so nothing is shared with the frame building.  while the application
+//		is writing a pose, wait a little and retry up to kXBusSeqRetry times.
+//		if it is not done by then, the last consistent pose in XBusServoEx is
+//		sent again, so the frame is not delayed by the writer
+//		2026/10/19 : add ESP32 bus task
+//		2026/10/19 : retry the pose being written
+//****************************************************************************
+void XBusTask::loadPose(void)
+{
+	uint32_t	pose[kXBusMaxServoNum];
+	uint32_t	seq;
+	int			numOfServo = xbus->getNumOfServo();
+	int			servoNo;
+	int			retry;
+
+	for (retry = 0; ; retry++)
+	{
+		if (retry >= kXBusSeqRetry)
+			return;										// keep the last consistent pose
+
+		if (retry > 0)
+			delayMicroseconds(kXBusTaskPoseWait);
+
+		seq = poseSeq;
+		if (seq & 1)
+			continue;									// the application is writing a pose
+		XBUS_MEMORY_BARRIER();
+
+		for (servoNo = 0; servoNo < numOfServo; servoNo++)
+			pose[servoNo] = slotValue[servoNo];
+
+		XBUS_MEMORY_BARRIER();
+		if (poseSeq == seq)
+			break;										// no pose was written during the copy
+	}
+
+	for (servoNo = 0; servoNo < numOfServo; servoNo++)
+	{
+		if ((pose[servoNo] & kXBusTaskSlotSet) && (pose[servoNo] != taskValue[servoNo]))
+		{
+			xbus->setServoByIndex(servoNo, pose[servoNo] & 0xFFFF);
+			taskValue[servoNo] = pose[servoNo];
+		}
+	}
+}
+
+
+//****************************************************************************
+//	XBusTask::sendFrame
+//		return :		none
+//		parameter :	none
+//
+//		2026/10/19 : add ESP32 bus task
+//****************************************************************************
+void XBusTask::sendFrame(void)
+{
+	switch (serialNo)
+	{
+		case 0:
+			xbus->sendChannelDataPacket();
+			break;
+		case 1:
+			xbus->sendChannelDataPacket1();
+			break;
+		case 2:
+			xbus->sendChannelDataPacket2();
+			break;
+	}
+}
+
+
+//****************************************************************************
+//	XBusTask::doCommand
+//		return :		none
+//		parameter :	req			the command from the application
+//					frameTime	micros() when the channel data packet was sent
+//
+//		send the command and wait for the response.  the command is sent
+//		after the channel data packet and its echo are over.  the frames are
+//		stopped while waiting, so the command has its own short timeout
+//		(kXBusTaskCommandTimeOut) whatever setCommandTimeOut is, and the wait
+//		yields instead of vTaskDelay, which sleeps at least one tick
+//		2026/10/19 : add ESP32 bus task
+//		2026/10/19 : wait for the channel data packet
+//		2026/10/19 : wait only for kXBusTaskCommandTimeOut without vTaskDelay
+//****************************************************************************
+void XBusTask::doCommand(Request* req, unsigned long frameTime)
+{
+	XBusError		result;
+	int				value = req->value;
+	unsigned long	frameSize = 4 + xbus->getNumOfServo() * 4 + 1;
+
+	while ((micros() - frameTime) < frameSize * kXBusByteTime + kXBusResponseGap)
+		taskYIELD();
+
+	if (req->command == kXBusCmd_Set)
+		result = xbus->startSetCommand(req->channelID, req->order, value, kXBusTaskCommandTimeOut);
+	else
+		result = xbus->startGetCommand(req->channelID, req->order, kXBusTaskCommandTimeOut);
+
+	if (result == kXBusError_NoError)
+	{
+		while ((result = xbus->pollCommand(&value)) == kXBusError_Pending)
+			taskYIELD();
+	}
+
+	req->value = value;
+	req->result = result;
+	xTaskNotifyGive(req->caller);
+}
+
+
+#endif	// of ARDUINO_ARCH_ESP32
@@ -0,0 +1,74 @@
+/* XBusTask.h file
+ *
+ * for Arduino (ESP32)
+ *
+ * FreeRTOS task owning the XBus port on ESP32
+ */
+
+#ifndef XBusTask_h
+#define XBusTask_h
+#include "XBusServoEx.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+
+#define	kXBusTaskStackSize			4096
+#define	kXBusTaskQueueSize			4				// commands waiting for the bus task
+#define	kXBusTaskSlotSet			0x10000			// the slot has been written
+#define	kXBusTaskCommandTimeOut		5000			// uSec.  timeout of the command.  the frames are stopped until then
+#define	kXBusTaskPoseWait			20				// uSec.  wait for the pose being written before the retry
+
+
+class XBusTask
+	{
+		public:
+			XBusTask(XBusServoEx& servo, int serialNo);
+
+		public:
+			XBusError		begin(int core, unsigned int priority);
+			void			end(void);
+
+			XBusError		setServo(int servoNo, unsigned int value);
+			void			beginPose(void);
+			void			endPose(void);
+
+			XBusError		setCommand(char channelID, char order, int* value);
+			XBusError		getCommand(char channelID, char order, int* value);
+
+			unsigned long	getMaxJitter(void);
+
+		private:
+			typedef struct
+			{
+				char			command;
+				char			channelID;
+				char			order;
+				int				value;
+				XBusError		result;
+				TaskHandle_t	caller;
+			} Request;
+
+			XBusServoEx*	xbus;
+			int				serialNo;					// 0 to 2 for Serial to Serial2
+			TaskHandle_t	task;
+			QueueHandle_t	commandQueue;				// pointers to Request
+			volatile bool	running;					// cleared by end() to stop the bus task
+			volatile bool	stopped;					// set by the bus task at the end
+			volatile uint32_t	slotValue[kXBusMaxServoNum];	// setpoint written by the application | kXBusTaskSlotSet
+			volatile uint32_t	poseSeq;				// odd while the application writes a pose
+			uint32_t		taskValue[kXBusMaxServoNum];	// setpoint given to XBusServoEx
+			unsigned long	maxJitter;					// uSec
+
+			static void		taskEntry(void* param);
+			void			run(void);
+			void			loadPose(void);
+			void			sendFrame(void);
+			void			doCommand(Request* req, unsigned long frameTime);
+			XBusError		request(char command, char channelID, char order, int* value);
+	};
+
+
+#endif	// of ARDUINO_ARCH_ESP32
+#endif	// of XBusTask_h
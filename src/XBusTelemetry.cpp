@@ -0,0 +1,473 @@
+/* XBusTelemetry.cpp file
+ *
+ * for Arduino
+ *
+ * binary telemetry log of XBusServoEx with the double buffered writer
+ */
+
+#include "XBusTelemetry.h"
+
+#define	kBlockMagic0			0
+#define	kBlockMagic1			1
+#define	kBlockNo				2
+#define	kBlockUsed				4
+#define	kBlockServoNum			6
+#define	kBlockSamples			7
+
+
+//****************************************************************************
+//	XBusTelemetry::XBusTelemetry
+//		return :		none
+//		parameter :	servo		XBusServoEx to log
+//					maxServoNum	max number of servos.  same as XBusServoEx
+//					buffer		buffer for 2 blocks (blockSize * 2 bytes)
+//					blockSize	size of a block.  512 for SD card
+//
+//		Constructor
+//		2026/10/19 : add telemetry log
+//****************************************************************************
+XBusTelemetry::XBusTelemetry(XBusServoEx& servo, unsigned int maxServoNum, uint8_t* buffer, unsigned int blockSize)
+{
+	xbus = &servo;
+	maxServo = maxServoNum;
+	out = NULL;
+	block[0] = buffer;
+	block[1] = buffer + blockSize;
+	this->blockSize = blockSize;
+	used = 0;
+	active = 0;
+	pending = -1;
+	pendingOffset = 0;
+	blockNo = 0;
+	samples = 0;
+	drops = 0;
+	feedback = NULL;
+	last = NULL;
+	readServo = 0;
+	readOrder = kXBusOrder_2_CurrentPos;
+	busy = 0;
+#if defined(ARDUINO_ARCH_ESP32)
+	task = NULL;
+	running = false;
+	stopped = true;
+#endif
+}
+
+
+//****************************************************************************
+//	XBusTelemetry::begin
+//		return :		error code
+//		parameter :	out			destination of the log like File of SD
+//
+//		the block must have the room for the header and a sample of
+//		maxServoNum servos (XBusTelemetrySampleSize).  on ESP32 the full
+//		blocks are written by a FreeRTOS task
+//		2026/10/19 : add telemetry log
+//****************************************************************************
+XBusError XBusTelemetry::begin(Print& out)
+{
+	unsigned int	index;
+
+	if (blockSize < kXBusTelemetryHeaderSize + maxServo + XBusTelemetrySampleSize(maxServo))
+		return kXBusError_MemoryFull;
+
+	end();
+
+	feedback = (Feedback*)malloc(sizeof(Feedback) * maxServo);
+	last = (long*)malloc(sizeof(long) * (1 + maxServo * kXBusTelemetryFields));
+	if ((feedback == NULL) || (last == NULL))
+	{
+		end();
+		return kXBusError_MemoryFull;
+	}
+
+	for (index = 0; index < maxServo; index++)
+	{
+		feedback[index].position = kXBusTelemetryUnknown;
+		feedback[index].power = kXBusTelemetryUnknown;
+		feedback[index].error = kXBusError_NoError;
+	}
+
+	this->out = &out;
+	active = 0;
+	pending = -1;
+	blockNo = 0;
+	samples = 0;
+	drops = 0;
+	readServo = 0;
+	busy = 0;
+	openBlock();
+
+#if defined(ARDUINO_ARCH_ESP32)
+	running = true;
+	stopped = false;
+	if (xTaskCreatePinnedToCore(taskEntry, "XBusLog", kXBusTelemetryStackSize, this, 1, &task, xPortGetCoreID() ^ 1) != pdPASS)
+	{
+		running = false;
+		stopped = true;
+		end();
+		return kXBusError_MemoryFull;
+	}
+#endif
+
+	return kXBusError_NoError;
+}
+
+
+//****************************************************************************
+//	XBusTelemetry::end
+//		return :		none
+//		parameter :	none
+//
+//		write the blocks left and stop.  this blocks until they are written
+//		2026/10/19 : add telemetry log
+//****************************************************************************
+void XBusTelemetry::end(void)
+{
+	int			value;
+
+	// wait the command in progress not to leave the bus in Rx
+	while (busy && (xbus->pollCommand(&value) == kXBusError_Pending))
+		;
+	busy = 0;
+
+#if defined(ARDUINO_ARCH_ESP32)
+	if (task != NULL)
+	{
+		running = false;
+		xTaskNotifyGive(task);
+		while (! stopped)
+			vTaskDelay(1);
+		task = NULL;
+	}
+#endif
+
+	if (out != NULL)
+	{
+		if (pending >= 0)
+			writeChunk(blockSize - pendingOffset);
+		if (block[active][kBlockSamples] > 0)
+		{
+			closeBlock();
+			writeChunk(blockSize);
+		}
+		out->flush();
+	}
+	out = NULL;
+
+	if (feedback != NULL)
+		free(feedback);
+	feedback = NULL;
+	if (last != NULL)
+		free(last);
+	last = NULL;
+}
+
+
+//****************************************************************************
+//	XBusTelemetry::update
+//		return :		none
+//		parameter :	none
+//
+//		call this in loop().  it does not block.  it reads the current
+//		position and the current power of the servos one by one, and on AVR
+//		it writes kXBusTelemetryChunkSize bytes of the full block
+//		2026/10/19 : add telemetry log
+//****************************************************************************
+void XBusTelemetry::update(void)
+{
+	if (out == NULL)
+		return;
+
+	read();
+
+#if ! defined(ARDUINO_ARCH_ESP32)
+	if (pending >= 0)
+		writeChunk(kXBusTelemetryChunkSize);
+#endif
+}
+
+
+//****************************************************************************
+//	XBusTelemetry::sample
+//		return :		none
+//		parameter :	none
+//
+//		add one sample to the log.  call this once for each frame.  the time
+//		is fixed by the number of servos: it only encodes the values to the
+//		block in RAM.  when both blocks are full, the sample is lost and
+//		counted by dropCount()
+//		2026/10/19 : add telemetry log
+//****************************************************************************
+void XBusTelemetry::sample(void)
+{
+	int			numOfServo;
+	int			servoNo;
+	long*		lastValue;
+
+	if (out == NULL)
+		return;
+
+	numOfServo = xbus->getNumOfServo();
+	if ((unsigned int)numOfServo > maxServo)
+		numOfServo = maxServo;
+	if (((unsigned int)numOfServo != block[active][kBlockServoNum])
+			|| (used + XBusTelemetrySampleSize(numOfServo) > blockSize)
+			|| (block[active][kBlockSamples] == 0xFF))
+	{
+		// the servos are changed or the block is full
+		if ((block[active][kBlockSamples] > 0) && ! closeBlock())
+		{
+			drops++;
+			return;
+		}
+		openBlock();
+	}
+
+	lastValue = last;
+	put(micros(), lastValue++);
+	for (servoNo = 0; servoNo < numOfServo; servoNo++)
+	{
+		put(xbus->getServoByIndex(servoNo), lastValue++);
+		put(feedback[servoNo].position, lastValue++);
+		put(feedback[servoNo].power, lastValue++);
+		put(feedback[servoNo].error, lastValue++);
+	}
+
+	block[active][kBlockSamples]++;
+	samples++;
+}
+
+
+//****************************************************************************
+//	XBusTelemetry::sampleCount / dropCount / blockCount
+//		return :		samples logged / samples lost / blocks completed
+//		parameter :	none
+//
+//		2026/10/19 : add telemetry log
+//****************************************************************************
+unsigned long XBusTelemetry::sampleCount(void)
+{
+	return samples;
+}
+
+unsigned long XBusTelemetry::dropCount(void)
+{
+	return drops;
+}
+
+unsigned int XBusTelemetry::blockCount(void)
+{
+	return blockNo;
+}
+
+
+//****************************************************************************
+//	XBusTelemetry::openBlock
+//		return :		none
+//		parameter :	none
+//
+//		start the active block with the header and the channel IDs
+//		2026/10/19 : add telemetry log
+//****************************************************************************
+void XBusTelemetry::openBlock(void)
+{
+	uint8_t*	data = block[active];
+	int			numOfServo = xbus->getNumOfServo();
+	int			servoNo;
+
+	if ((unsigned int)numOfServo > maxServo)
+		numOfServo = maxServo;
+
+	memset(data, 0, blockSize);
+	data[kBlockMagic0] = kXBusTelemetryMagic0;
+	data[kBlockMagic1] = kXBusTelemetryMagic1;
+	data[kBlockNo] = blockNo;
+	data[kBlockNo + 1] = blockNo >> 8;
+	data[kBlockServoNum] = numOfServo;
+	for (servoNo = 0; servoNo < numOfServo; servoNo++)
+		data[kXBusTelemetryHeaderSize + servoNo] = xbus->getServoID(servoNo);
+
+	used = kXBusTelemetryHeaderSize + numOfServo;
+	memset(last, 0, sizeof(long) * (1 + maxServo * kXBusTelemetryFields));
+}
+
+
+//****************************************************************************
+//	XBusTelemetry::closeBlock
+//		return :		true if the block is passed to the writer
+//		parameter :	none
+//
+//		the block can not be passed while the other block is being written.
+//		pending hands the block over to the writer (the task on the other
+//		core on ESP32).  the block and pendingOffset are written before
+//		pending with the memory barrier between, and the writer reads them
+//		after pending
+//		2026/10/19 : add telemetry log
+//		2026/10/19 : add the memory barrier for the writer on the other core
+//****************************************************************************
+bool XBusTelemetry::closeBlock(void)
+{
+	if (pending >= 0)
+		return false;
+	XBUS_MEMORY_BARRIER();									// the writer is done with the block
+
+	block[active][kBlockUsed] = used;
+	block[active][kBlockUsed + 1] = used >> 8;
+	blockNo++;
+
+	pendingOffset = 0;
+	XBUS_MEMORY_BARRIER();									// the block is written before it is passed
+	pending = active;
+	active ^= 1;
+
+#if defined(ARDUINO_ARCH_ESP32)
+	if (task != NULL)
+		xTaskNotifyGive(task);
+#endif
+
+	return true;
+}
+
+
+//****************************************************************************
+//	XBusTelemetry::put
+//		return :		none
+//		parameter :	value		value to log
+//					lastValue	the same value of the last sample.  updated
+//
+//		put the difference in zigzag varint (7 bits in each byte from the
+//		lower bits.  the top bit is set if more bytes follow)
+//		2026/10/19 : add telemetry log
+//****************************************************************************
+void XBusTelemetry::put(long value, long* lastValue)
+{
+	long			delta = (long)((unsigned long)value - (unsigned long)*lastValue);
+	unsigned long	code = ((unsigned long)delta << 1) ^ (unsigned long)(delta >> (sizeof(long) * 8 - 1));
+	uint8_t*		data = block[active];
+
+	*lastValue = value;
+	while (code >= 0x80)
+	{
+		data[used++] = (code & 0x7F) | 0x80;
+		code >>= 7;
+	}
+	data[used++] = code;
+}
+
+
+//****************************************************************************
+//	XBusTelemetry::read
+//		return :		none
+//		parameter :	none
+//
+//		read the current position and the current power of each servo in
+//		turn without blocking.  the command of the sketch returns
+//		kXBusError_BusBusy while this waits the response.  the command has
+//		its own short timeout (kXBusTelemetryTimeOut) whatever setCommandTimeOut is
+//		2026/10/19 : add telemetry log
+//		2026/10/19 : give the timeout to each command
+//****************************************************************************
+void XBusTelemetry::read(void)
+{
+	XBusError		result;
+	int				value;
+	char			channelID;
+
+	if (busy)
+	{
+		result = xbus->pollCommand(&value);
+		if (result == kXBusError_Pending)
+			return;
+
+		busy = 0;
+		if (readServo < xbus->getNumOfServo())
+		{
+			feedback[readServo].error = result;
+			if (result == kXBusError_NoError)
+			{
+				if (readOrder == kXBusOrder_2_CurrentPos)
+					feedback[readServo].position = value & 0xFFFF;
+				else
+					feedback[readServo].power = value & 0xFF;
+			}
+		}
+
+		// the position then the power of the servo, then the next servo
+		if (readOrder == kXBusOrder_2_CurrentPos)
+			readOrder = kXBusOrder_1_CurrentPow;
+		else
+		{
+			readOrder = kXBusOrder_2_CurrentPos;
+			readServo++;
+		}
+		return;
+	}
+
+	if (readServo >= xbus->getNumOfServo())
+		readServo = 0;
+	channelID = xbus->getServoID(readServo);
+	if (channelID == 0)
+		return;
+
+	if (xbus->startGetCommand(channelID, readOrder, kXBusTelemetryTimeOut) == kXBusError_NoError)
+		busy = 1;
+}
+
+
+//****************************************************************************
+//	XBusTelemetry::writeChunk
+//		return :		none
+//		parameter :	size		max bytes to write
+//
+//		write the pending block from pendingOffset.  the block is released
+//		when all bytes are written.  the memory barriers pair with closeBlock
+//		2026/10/19 : add telemetry log
+//		2026/10/19 : add the memory barrier for the writer on the other core
+//****************************************************************************
+void XBusTelemetry::writeChunk(unsigned int size)
+{
+	if (pending < 0)
+		return;
+	XBUS_MEMORY_BARRIER();									// read the block after pending
+
+	if (size > blockSize - pendingOffset)
+		size = blockSize - pendingOffset;
+
+	out->write(block[pending] + pendingOffset, size);
+	pendingOffset += size;
+	if (pendingOffset >= blockSize)
+	{
+		XBUS_MEMORY_BARRIER();								// the block is read before it is released
+		pending = -1;
+	}
+}
+
+
+#if defined(ARDUINO_ARCH_ESP32)
+
+//****************************************************************************
+//	XBusTelemetry::taskEntry
+//		return :		none
+//		parameter :	param		XBusTelemetry
+//
+//		the writer task.  it writes the whole block when it is notified,
+//		so the SD card never stalls the loop task
+//		2026/10/19 : add telemetry log
+//****************************************************************************
+void XBusTelemetry::taskEntry(void* param)
+{
+	XBusTelemetry*	log = (XBusTelemetry*)param;
+
+	while (log->running)
+	{
+		ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+		if (log->pending >= 0)
+			log->writeChunk(log->blockSize);
+	}
+
+	log->stopped = true;
+	vTaskDelete(NULL);
+}
+
+#endif	// of ARDUINO_ARCH_ESP32
@@ -0,0 +1,102 @@
+/* XBusTelemetry.h file
+ *
+ * for Arduino
+ *
+ * binary telemetry log of XBusServoEx with the double buffered writer
+ */
+
+#ifndef XBusTelemetry_h
+#define XBusTelemetry_h
+#include "XBusServoEx.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#endif
+
+// the log is written in the blocks of blockSize bytes.  each block can be
+// decoded alone :
+//	[0] [1]		kXBusTelemetryMagic0, kXBusTelemetryMagic1
+//	[2] [3]		block number.  little endian
+//	[4] [5]		bytes used in the block including this header.  little endian
+//	[6]			number of servos (n)
+//	[7]			number of samples in the block
+//	[8] ...		channel ID of each servo (n bytes)
+//	then the samples.  each value is the difference from the same value of
+//	the last sample in the block (0 for the first sample) in zigzag varint :
+//		micros()
+//		for each servo : command value, kXBusOrder_2_CurrentPos,
+//						 kXBusOrder_1_CurrentPow, error of the last read
+//	the rest of the block is 0.
+// extras/xbus_telemetry_decode.cpp decodes the log on the host.
+
+#define	kXBusTelemetryMagic0		'X'
+#define	kXBusTelemetryMagic1		'T'
+#define	kXBusTelemetryHeaderSize	8
+#define	kXBusTelemetryFields		4				// values of each servo in a sample
+#define	kXBusTelemetryChunkSize		64				// bytes written by one update() on AVR
+#define	kXBusTelemetryStackSize		4096
+#define	kXBusTelemetryUnknown		-1				// the value is not read yet
+#define	kXBusTelemetryTimeOut		5000			// uSec.  timeout of the command.  the frames are stopped until then
+
+// max size of a sample : 5 bytes for the time, 3 bytes for each value
+#define	XBusTelemetrySampleSize(numOfServo)		(5 + (numOfServo) * kXBusTelemetryFields * 3)
+
+
+class XBusTelemetry
+	{
+		public:
+			XBusTelemetry(XBusServoEx& servo, unsigned int maxServoNum, uint8_t* buffer, unsigned int blockSize);
+
+		public:
+			XBusError		begin(Print& out);
+			void			end(void);
+			void			update(void);
+			void			sample(void);
+			unsigned long	sampleCount(void);
+			unsigned long	dropCount(void);
+			unsigned int	blockCount(void);
+
+		private:
+			typedef struct
+			{
+				int				position;				// last kXBusOrder_2_CurrentPos
+				int				power;					// last kXBusOrder_1_CurrentPow
+				int				error;					// result of the last read
+			} Feedback;
+
+			XBusServoEx*	xbus;
+			unsigned int	maxServo;
+			Print*			out;
+			uint8_t*		block[2];					// the block being filled and the block being written
+			unsigned int	blockSize;
+			unsigned int	used;						// bytes used in the active block
+			uint8_t			active;						// index of the block being filled
+			volatile int8_t	pending;					// index of the full block to write.  -1 if none
+			unsigned int	pendingOffset;				// bytes of the pending block written
+			unsigned int	blockNo;
+			unsigned long	samples;
+			unsigned long	drops;						// samples lost while both blocks are full
+			Feedback*		feedback;					// for each servo in the order it was added
+			long*			last;						// values of the last sample in the block
+			int				readServo;					// servo being read
+			char			readOrder;					// order being read
+			char			busy;						// 1 while waiting the response
+
+			void			openBlock(void);
+			bool			closeBlock(void);
+			void			put(long value, long* lastValue);
+			void			read(void);
+			void			writeChunk(unsigned int size);
+
+#if defined(ARDUINO_ARCH_ESP32)
+			TaskHandle_t	task;
+			volatile bool	running;					// cleared by end() to stop the writer task
+			volatile bool	stopped;					// set by the writer task at the end
+
+			static void		taskEntry(void* param);
+#endif
+	};
+
+
+#endif	// of XBusTelemetry_h